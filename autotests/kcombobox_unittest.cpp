@@ -109,6 +109,38 @@ private Q_SLOTS:
         combo.insertItems(0, QStringList() << QStringLiteral("foo"));
     }
 
+    void testHistoryComboDuplicates()
+    {
+        KHistoryComboBox combo;
+        combo.setDuplicatesEnabled(false);
+        combo.setMaxCount(3);
+        KCompletion *completion = combo.completionObject();
+
+        for (const char *item : {"a", "b", "c", "a"}) {
+            combo.addToHistory(QString::fromLatin1(item));
+        }
+        QCOMPARE(combo.historyItems(), QStringList({QStringLiteral("a"), QStringLiteral("c"), QStringLiteral("b")}));
+
+        // trimmed items leave the completion object
+        combo.addToHistory(QStringLiteral("d"));
+        QCOMPARE(combo.historyItems(), QStringList({QStringLiteral("d"), QStringLiteral("a"), QStringLiteral("c")}));
+        QVERIFY(completion->allMatches(QStringLiteral("b")).isEmpty());
+        QCOMPARE(completion->allMatches(QStringLiteral("c")), QStringList{QStringLiteral("c")});
+
+        // items changed behind the back of the history are taken into account
+        combo.setItemText(1, QStringLiteral("c"));
+        combo.addToHistory(QStringLiteral("c"));
+        QCOMPARE(combo.historyItems(), QStringList({QStringLiteral("c"), QStringLiteral("d")}));
+        combo.insertItem(2, QStringLiteral("e"));
+        combo.addToHistory(QStringLiteral("e"));
+        QCOMPARE(combo.historyItems(), QStringList({QStringLiteral("e"), QStringLiteral("c"), QStringLiteral("d")}));
+
+        QVERIFY(combo.removeFromHistory(QStringLiteral("c")));
+        QVERIFY(!combo.removeFromHistory(QStringLiteral("c")));
+        QCOMPARE(combo.historyItems(), QStringList({QStringLiteral("e"), QStringLiteral("d")}));
+        QVERIFY(completion->allMatches(QStringLiteral("c")).isEmpty());
+    }
+
     void testHistoryComboReset()
     {
         // It only tests that it doesn't crash
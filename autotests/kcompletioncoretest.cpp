@@ -6,8 +6,13 @@
 */
 
 #include "kcompletioncoretest.h"
+#include "kcompletionmatches.h"
+#include <QLoggingCategory>
+#include <QRegularExpression>
 #include <QSignalSpy>
 #include <QTest>
+#include <QThreadPool>
+#include <algorithm>
 #define clampet strings[0]
 #define coolcat strings[1]
 #define carpet strings[2]
@@ -360,6 +365,608 @@ void Test_KCompletion::cycleMatches_Weighted()
     QCOMPARE(completion.previousMatch(), carp);
 }
 
+void Test_KCompletion::itemInterning()
+{
+    KCompletion completion;
+    QVERIFY(!completion.itemInterning());
+    completion.setCompletionMode(KCompletion::CompletionAuto);
+    completion.setOrder(KCompletion::Sorted);
+    completion.setItems(strings);
+    const QStringList expected = completion.allMatches(QStringLiteral("c"));
+
+    // enabling interning afterwards picks up the existing items
+    completion.setItemInterning(true);
+    QVERIFY(completion.itemInterning());
+    QCOMPARE(completion.allMatches(QStringLiteral("c")), expected);
+    QCOMPARE(completion.substringCompletion(QStringLiteral("pet")), QStringList({carpet, clampet}));
+    QCOMPARE(completion.makeCompletion(QStringLiteral("coo")), coolcat);
+
+    completion.removeItem(carpet);
+    QCOMPARE(completion.allMatches(QStringLiteral("ca")), QStringList{carp});
+    completion.addItem(carpet);
+    QCOMPARE(completion.allMatches(QStringLiteral("c")), expected);
+    QCOMPARE(completion.items().count(), strings.count());
+
+    completion.setIgnoreCase(true);
+    QCOMPARE(completion.allMatches(QStringLiteral("CA")), QStringList({carp, carpet}));
+    completion.setIgnoreCase(false);
+
+    completion.clear();
+    QVERIFY(completion.allMatches(QStringLiteral("c")).isEmpty());
+
+    completion.setOrder(KCompletion::Weighted);
+    completion.setItems(wstrings);
+    QCOMPARE(completion.allMatches(QStringLiteral("c")), QStringList({carpet, clampet, coolcat, carp}));
+    QCOMPARE(completion.items().count(), wstrings.count());
+
+    completion.setItemInterning(false);
+    QCOMPARE(completion.allMatches(QStringLiteral("c")), QStringList({carpet, clampet, coolcat, carp}));
+}
+
+void Test_KCompletion::deepTree()
+{
+    // every level of the tree branches
+    constexpr int depth = 3000;
+    QStringList items;
+    for (int i = 1; i <= depth; ++i) {
+        items.append(QString(i, QLatin1Char('a')));
+    }
+
+    KCompletion completion;
+    completion.setItems(items);
+    QCOMPARE(completion.allMatches(QStringLiteral("a")), items);
+    QCOMPARE(completion.items(), items);
+
+    completion.setItemInterning(true);
+    QCOMPARE(completion.allMatches(QStringLiteral("aa")), items.mid(1));
+
+    completion.setOrder(KCompletion::Weighted);
+    completion.setItems(items);
+    const QStringList weightedItems = completion.items();
+    QCOMPARE(weightedItems.count(), depth);
+    QCOMPARE(weightedItems.constFirst(), QStringLiteral("a:1"));
+    QCOMPARE(weightedItems.constLast(), items.constLast() + QStringLiteral(":1"));
+}
+
+void Test_KCompletion::wideTree()
+{
+    // enough different first characters for the children of the root to be indexed,
+    // some of them beyond Latin-1
+    QStringList items;
+    for (char16_t ch = 0x21; ch < 0x21 + 300; ++ch) {
+        items.append(QChar(ch) + QStringLiteral("x"));
+    }
+
+    KCompletion completion;
+    completion.setItems(items);
+    QCOMPARE(completion.items(), items);
+    for (const QString &item : std::as_const(items)) {
+        QCOMPARE(completion.allMatches(item.left(1)), QStringList{item});
+    }
+    QVERIFY(completion.allMatches(QStringLiteral("~y")).isEmpty());
+
+    // removing items keeps the others to be found, also once only a few are left
+    QStringList remaining = items;
+    for (int i = 0; i < items.count(); i += 2) {
+        completion.removeItem(items.at(i));
+        remaining.removeOne(items.at(i));
+        QVERIFY(completion.allMatches(items.at(i).left(1)).isEmpty());
+    }
+    QCOMPARE(completion.items(), remaining);
+    while (remaining.count() > 3) {
+        completion.removeItem(remaining.takeFirst());
+    }
+    for (const QString &item : std::as_const(remaining)) {
+        QCOMPARE(completion.makeCompletion(item.left(1)), item);
+    }
+
+    // sorted insertion inserts in the middle of the children
+    completion.setOrder(KCompletion::Sorted);
+    QStringList reversed = items;
+    std::reverse(reversed.begin(), reversed.end());
+    completion.setItems(reversed);
+    QCOMPARE(completion.items(), items);
+    for (const QString &item : std::as_const(items)) {
+        QCOMPARE(completion.allMatches(item.left(1)), QStringList{item});
+    }
+}
+
+void Test_KCompletion::parallelInsertion_data()
+{
+    QTest::addColumn<KCompletion::CompOrder>("order");
+    QTest::addColumn<bool>("interning");
+
+    QTest::newRow("insertion") << KCompletion::Insertion << false;
+    QTest::newRow("sorted") << KCompletion::Sorted << false;
+    QTest::newRow("weighted") << KCompletion::Weighted << false;
+    QTest::newRow("insertion/interned") << KCompletion::Insertion << true;
+    QTest::newRow("weighted/interned") << KCompletion::Weighted << true;
+}
+
+void Test_KCompletion::parallelInsertion()
+{
+    QFETCH(KCompletion::CompOrder, order);
+    QFETCH(bool, interning);
+    if (QThreadPool::globalInstance()->maxThreadCount() < 4) {
+        QThreadPool::globalInstance()->setMaxThreadCount(4);
+    }
+
+    // common prefixes, duplicates, items shorter than the partitions and empty ones
+    QStringList items = {QStringLiteral("a"), QString(), QStringLiteral("/"), QStringLiteral("ab:3"), QStringLiteral(":7")};
+    for (int i = 0; i < 3000; ++i) {
+        const QString item = QStringLiteral("/%1/%2/file%3:%4").arg(QChar(u'a' + i % 7)).arg(i % 13).arg(i % 1000).arg(i % 5);
+        items.append(i % 3 ? item : item.toUpper());
+    }
+
+    const auto fill = [&](KCompletion &completion, int parallelThreshold) {
+        completion.setOrder(order);
+        completion.setItemInterning(interning);
+        completion.setParallelThreshold(parallelThreshold);
+        completion.setCompletionMode(KCompletion::CompletionAuto);
+        completion.setItems(QStringList{QStringLiteral("/b/old")});
+        completion.insertItems(items);
+    };
+    KCompletion serial;
+    fill(serial, 0);
+    KCompletion parallel;
+    fill(parallel, 100);
+    QCOMPARE(parallel.parallelThreshold(), 100);
+
+    QCOMPARE(parallel.items(), serial.items());
+    for (const QString &prefix : {QStringLiteral("/"), QStringLiteral("/c/1"), QStringLiteral("/D/"), QStringLiteral("a")}) {
+        QCOMPARE(parallel.allMatches(prefix), serial.allMatches(prefix));
+        QCOMPARE(parallel.allWeightedMatches(prefix).list(), serial.allWeightedMatches(prefix).list());
+        QCOMPARE(parallel.makeCompletion(prefix), serial.makeCompletion(prefix));
+    }
+
+    // the nodes built in parallel can be removed again
+    parallel.removeItem(QStringLiteral("/a/0/file0"));
+    serial.removeItem(QStringLiteral("/a/0/file0"));
+    QCOMPARE(parallel.items(), serial.items());
+    parallel.clear();
+    QVERIFY(parallel.isEmpty());
+}
+
+void Test_KCompletion::parallelScans_data()
+{
+    QTest::addColumn<KCompletion::CompOrder>("order");
+    QTest::addColumn<bool>("interning");
+
+    QTest::newRow("insertion") << KCompletion::Insertion << false;
+    QTest::newRow("sorted") << KCompletion::Sorted << false;
+    QTest::newRow("weighted") << KCompletion::Weighted << false;
+    QTest::newRow("insertion/interned") << KCompletion::Insertion << true;
+    QTest::newRow("weighted/interned") << KCompletion::Weighted << true;
+}
+
+void Test_KCompletion::parallelScans()
+{
+    QFETCH(KCompletion::CompOrder, order);
+    QFETCH(bool, interning);
+    if (QThreadPool::globalInstance()->maxThreadCount() < 4) {
+        QThreadPool::globalInstance()->setMaxThreadCount(4);
+    }
+
+    // mixed case, items that are prefixes of others, and a single deep branch
+    QStringList items = {QStringLiteral("/"), QStringLiteral("/Deep/only/child:9"), QStringLiteral("file:2")};
+    for (int i = 0; i < 2000; ++i) {
+        const QString item = QStringLiteral("/%1/%2/File%3:%4").arg(QChar(u'a' + i % 5)).arg(i % 11).arg(i % 700).arg(i % 3);
+        items.append(i % 2 ? item : item.toUpper());
+    }
+
+    const auto fill = [&](KCompletion &completion, int parallelThreshold) {
+        completion.setOrder(order);
+        completion.setItemInterning(interning);
+        completion.setIgnoreCase(true);
+        completion.setParallelThreshold(parallelThreshold);
+        completion.insertItems(items);
+    };
+    KCompletion serial;
+    fill(serial, 0);
+    KCompletion parallel;
+    fill(parallel, 100);
+
+    const auto compare = [&]() {
+        for (const QString &string : {QString(), QStringLiteral("file1"), QStringLiteral("/B/1"), QStringLiteral("deep")}) {
+            QCOMPARE(parallel.substringCompletion(string), serial.substringCompletion(string));
+        }
+        for (const QString &prefix : {QStringLiteral("/"), QStringLiteral("/c/"), QStringLiteral("/E/3/fILE"), QStringLiteral("/deep/")}) {
+            QCOMPARE(parallel.allMatches(prefix), serial.allMatches(prefix));
+            QCOMPARE(parallel.makeCompletion(prefix), serial.makeCompletion(prefix));
+        }
+    };
+    compare();
+
+    // removing items below the threshold goes back to the serial scans
+    for (const QString &item : items.mid(100)) {
+        // the weights aren't part of the weighted items
+        const QString key = order == KCompletion::Weighted ? item.left(item.lastIndexOf(QLatin1Char(':'))) : item;
+        parallel.removeItem(key);
+        serial.removeItem(key);
+    }
+    compare();
+    parallel.clear();
+    QVERIFY(parallel.substringCompletion(QStringLiteral("a")).isEmpty());
+}
+
+void Test_KCompletion::weightedMatchesLimit()
+{
+    KCompletion completion;
+    completion.setOrder(KCompletion::Weighted);
+    completion.setItems(wstrings);
+
+    const KCompletionMatches matches = completion.allWeightedMatches(QStringLiteral("c"));
+    const QStringList all = matches.list();
+    QCOMPARE(all, QStringList({carpet, clampet, coolcat, carp}));
+    for (qsizetype limit = 0; limit <= all.count() + 1; ++limit) {
+        QCOMPARE(matches.topMatches(limit), all.mid(0, limit));
+    }
+    QCOMPARE(matches.topMatches(2, false), matches.list(false).mid(0, 2));
+
+    // equal weights keep the order of a full sort
+    KCompletionMatchesList list;
+    for (int i = 0; i < 100; ++i) {
+        list.insert(i % 7, QString::number(i));
+    }
+    KCompletionMatchesList sorted = list;
+    sorted.sort();
+    std::reverse(sorted.begin(), sorted.end());
+    const KCompletionMatchesList best = list.largest(10);
+    QCOMPARE(best.count(), 10);
+    for (int i = 0; i < 10; ++i) {
+        QCOMPARE(best.at(i).value(), sorted.at(i).value());
+    }
+
+    list.partialSort(10, Qt::DescendingOrder);
+    for (int i = 0; i < 10; ++i) {
+        QCOMPARE(list.at(i).key(), sorted.at(i).key());
+    }
+    list.nthElement(50);
+    for (int i = 0; i < 50; ++i) {
+        QVERIFY(list.at(i) <= list.at(50));
+    }
+
+    completion.setCompletionMode(KCompletion::CompletionPopup);
+    QCOMPARE(completion.makeCompletion(QStringLiteral("c")), carpet);
+}
+
+void Test_KCompletion::streamMatches()
+{
+    KCompletion completion;
+    completion.setOrder(KCompletion::Weighted);
+    completion.setItems(wstrings);
+    QSignalSpy spy(&completion, &KCompletion::moreMatches);
+
+    // no chunk size, everything at once
+    QCOMPARE(completion.streamMatches(QStringLiteral("c")), QStringList({carpet, clampet, coolcat, carp}));
+    QVERIFY(!completion.hasMoreMatches());
+
+    completion.setMatchChunkSize(3);
+    QCOMPARE(completion.matchChunkSize(), 3);
+    QCOMPARE(completion.streamMatches(QStringLiteral("c")), QStringList({carpet, clampet, coolcat}));
+    QVERIFY(completion.hasMoreMatches());
+    completion.fetchMoreMatches();
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toStringList(), QStringList{carp});
+    QVERIFY(!completion.hasMoreMatches());
+
+    // the remaining chunks are delivered by the event loop
+    spy.clear();
+    completion.setMatchChunkSize(1);
+    QCOMPARE(completion.streamMatches(QStringLiteral("c")), QStringList{carpet});
+    QTRY_COMPARE(spy.count(), 3);
+    QCOMPARE(spy.at(0).at(0).toStringList(), QStringList{clampet});
+    QCOMPARE(spy.at(1).at(0).toStringList(), QStringList{coolcat});
+    QCOMPARE(spy.at(2).at(0).toStringList(), QStringList{carp});
+    QVERIFY(!completion.hasMoreMatches());
+
+    // a new completion cancels the pending chunks
+    spy.clear();
+    QCOMPARE(completion.streamMatches(QStringLiteral("c")), QStringList{carpet});
+    completion.makeCompletion(QStringLiteral("ca"));
+    QVERIFY(!completion.hasMoreMatches());
+    QTest::qWait(10);
+    QCOMPARE(spy.count(), 0);
+}
+
+void Test_KCompletion::streamCompletedMatches()
+{
+    KCompletion completion;
+    completion.setSoundsEnabled(false);
+    completion.setOrder(KCompletion::Weighted);
+    completion.setItems(wstrings);
+    completion.setCompletionMode(KCompletion::CompletionPopup);
+    completion.setMatchChunkSize(2);
+
+    // the popup shows the matches of the completion, without searching them again
+    QCOMPARE(completion.makeCompletion(QStringLiteral("c")), carpet);
+    QCOMPARE(completion.statistics().matchSearches(), quint64(1));
+    QCOMPARE(completion.streamMatches(QStringLiteral("c")), QStringList({carpet, clampet}));
+    QCOMPARE(completion.allMatches(), QStringList({carpet, clampet, coolcat, carp}));
+    QCOMPARE(completion.statistics().matchSearches(), quint64(1));
+    completion.fetchMoreMatches();
+    QVERIFY(!completion.hasMoreMatches());
+    QCOMPARE(completion.nextMatch(), clampet);
+
+    // other strings and changed items are searched
+    QCOMPARE(completion.streamMatches(QStringLiteral("ca")), QStringList({carpet, carp}));
+    QCOMPARE(completion.statistics().matchSearches(), quint64(2));
+    completion.makeCompletion(QStringLiteral("c"));
+    completion.addItem(QStringLiteral("cat"), 100);
+    QCOMPARE(completion.streamMatches(QStringLiteral("c")), QStringList({QStringLiteral("cat"), carpet}));
+    QCOMPARE(completion.statistics().matchSearches(), quint64(4));
+}
+
+void Test_KCompletion::resultCache()
+{
+    KCompletion completion;
+    QCOMPARE(completion.resultCacheSize(), 0);
+    completion.setResultCacheSize(8);
+    QCOMPARE(completion.resultCacheSize(), 8);
+    completion.setOrder(KCompletion::Sorted);
+    completion.setItems(strings);
+
+    const QStringList expected{carp, carpet};
+    QCOMPARE(completion.allMatches(QStringLiteral("ca")), expected);
+    QCOMPARE(completion.resultCacheMisses(), quint64(1));
+    QCOMPARE(completion.resultCacheHits(), quint64(0));
+    QCOMPARE(completion.allMatches(QStringLiteral("ca")), expected);
+    QCOMPARE(completion.resultCacheHits(), quint64(1));
+
+    // backspace and retype
+    completion.setCompletionMode(KCompletion::CompletionPopup);
+    QCOMPARE(completion.makeCompletion(QStringLiteral("c")), carp);
+    QCOMPARE(completion.makeCompletion(QStringLiteral("ca")), carp);
+    QCOMPARE(completion.resultCacheMisses(), quint64(2));
+    QCOMPARE(completion.resultCacheHits(), quint64(2));
+
+    // the case sensitivity is part of the query
+    completion.setIgnoreCase(true);
+    QCOMPARE(completion.allMatches(QStringLiteral("ca")), expected);
+    QCOMPARE(completion.resultCacheMisses(), quint64(3));
+    completion.setIgnoreCase(false);
+
+    // changing the items invalidates the cache
+    completion.addItem(QStringLiteral("carpool@test.org"));
+    QCOMPARE(completion.allMatches(QStringLiteral("ca")), QStringList({carp, carpet, QStringLiteral("carpool@test.org")}));
+    QCOMPARE(completion.resultCacheMisses(), quint64(4));
+    completion.removeItem(QStringLiteral("carpool@test.org"));
+    QCOMPARE(completion.allMatches(QStringLiteral("ca")), expected);
+    QCOMPARE(completion.resultCacheMisses(), quint64(5));
+
+    completion.setOrder(KCompletion::Weighted);
+    completion.setItems(wstrings);
+    QCOMPARE(completion.allMatches(QStringLiteral("ca")), QStringList({carpet, carp}));
+    QCOMPARE(completion.allWeightedMatches(QStringLiteral("ca")).list(), QStringList({carpet, carp}));
+    QCOMPARE(completion.resultCacheMisses(), quint64(6));
+    QCOMPARE(completion.resultCacheHits(), quint64(3));
+
+    completion.clear();
+    QVERIFY(completion.allMatches(QStringLiteral("ca")).isEmpty());
+    QCOMPARE(completion.resultCacheMisses(), quint64(7));
+
+    completion.setResultCacheSize(0);
+    QCOMPARE(completion.resultCacheSize(), 0);
+    completion.allMatches(QStringLiteral("ca"));
+    completion.allMatches(QStringLiteral("ca"));
+    // no misses are counted without a cache
+    QCOMPARE(completion.resultCacheMisses(), quint64(7));
+    QCOMPARE(completion.resultCacheHits(), quint64(3));
+}
+
+void Test_KCompletion::resultCacheSorterFunction()
+{
+    KCompletion completion;
+    completion.setResultCacheSize(8);
+    completion.setOrder(KCompletion::Sorted);
+    completion.setItems(strings);
+
+    const QStringList expected{carp, carpet};
+    QCOMPARE(completion.allMatches(QStringLiteral("ca")), expected);
+    QCOMPARE(completion.allMatches(QStringLiteral("ca")), expected);
+    QCOMPARE(completion.resultCacheHits(), quint64(1));
+
+    // the same query again is sorted by the new sorter function
+    completion.setSorterFunction([](QStringList &list) {
+        std::sort(list.begin(), list.end(), std::greater<QString>());
+    });
+    QCOMPARE(completion.allMatches(QStringLiteral("ca")), QStringList({carpet, carp}));
+    QCOMPARE(completion.allMatches(QStringLiteral("ca")), QStringList({carpet, carp}));
+
+    completion.setSorterFunction(nullptr);
+    QCOMPARE(completion.allMatches(QStringLiteral("ca")), expected);
+}
+
+void Test_KCompletion::allMatchesLimit()
+{
+    QStringList items;
+    for (int i = 0; i < 500; ++i) {
+        items << QStringLiteral("item%1@test.org").arg(i * 7919 % 500);
+    }
+
+    for (const KCompletion::CompOrder order : {KCompletion::Insertion, KCompletion::Sorted}) {
+        KCompletion completion;
+        completion.setOrder(order);
+        completion.setItems(items);
+        const QStringList all = completion.allMatches(QStringLiteral("item1"));
+        QCOMPARE(all.count(), 111);
+        for (const int limit : {0, 1, 2, 10, 110, 111, 200}) {
+            QCOMPARE(completion.allMatches(QStringLiteral("item1"), limit), all.mid(0, limit));
+        }
+        QCOMPARE(completion.allMatches(QStringLiteral("item1"), -1), all);
+        QVERIFY(completion.allMatches(QStringLiteral("nothing"), 10).isEmpty());
+    }
+
+    KCompletion completion;
+    completion.setOrder(KCompletion::Weighted);
+    completion.setItems(wstrings);
+    QCOMPARE(completion.allMatches(QStringLiteral("c"), 2), QStringList({carpet, clampet}));
+}
+
+void Test_KCompletion::fetchMatchesOnDemand()
+{
+    QStringList items;
+    for (int i = 0; i < 100; ++i) {
+        items << QStringLiteral("item%1").arg(i);
+    }
+
+    KCompletion completion;
+    completion.setOrder(KCompletion::Insertion);
+    completion.setItems(items);
+    completion.setMatchChunkSize(30);
+    completion.setFetchMatchesOnDemand(true);
+    QVERIFY(completion.fetchMatchesOnDemand());
+    QSignalSpy spy(&completion, &KCompletion::moreMatches);
+
+    const QStringList all = completion.allMatches(QStringLiteral("item"));
+    QStringList streamed = completion.streamMatches(QStringLiteral("item"));
+    QCOMPARE(streamed, all.mid(0, 30));
+    QVERIFY(completion.hasMoreMatches());
+
+    // nothing comes without asking
+    QTest::qWait(10);
+    QCOMPARE(spy.count(), 0);
+
+    while (completion.hasMoreMatches()) {
+        completion.fetchMoreMatches();
+        streamed += spy.takeLast().at(0).toStringList();
+    }
+    QCOMPARE(streamed, all);
+
+    // changing the items ends the stream
+    completion.streamMatches(QStringLiteral("item"));
+    QVERIFY(completion.hasMoreMatches());
+    completion.addItem(QStringLiteral("item100"));
+    QVERIFY(!completion.hasMoreMatches());
+
+    completion.setCompletionMode(KCompletion::CompletionPopup);
+    QSignalSpy multipleSpy(&completion, &KCompletion::multipleMatches);
+    QCOMPARE(completion.makeCompletion(QStringLiteral("item")), items.first());
+    QCOMPARE(multipleSpy.count(), 1);
+    QCOMPARE(completion.makeCompletion(QStringLiteral("item100")), QStringLiteral("item100"));
+    QCOMPARE(multipleSpy.count(), 1);
+}
+
+void Test_KCompletion::completionRequests()
+{
+    KCompletion completion;
+    completion.setSoundsEnabled(false);
+    completion.setItems(strings);
+    QSignalSpy spy(&completion, &KCompletion::completionReady);
+
+    QObject first;
+    QObject second;
+    QObject third;
+    completion.requestCompletion(&first, QStringLiteral("c"));
+    completion.requestCompletion(&second, QStringLiteral("co"));
+    completion.requestCompletion(&third, QStringLiteral("ca"));
+    // supersedes the first request
+    completion.requestCompletion(&first, QStringLiteral("cl"));
+    completion.cancelCompletionRequest(&third);
+    QVERIFY(completion.hasCompletionRequest(&first));
+    QVERIFY(!completion.hasCompletionRequest(&third));
+    QCOMPARE(spy.count(), 0);
+
+    QTRY_COMPARE(spy.count(), 2);
+    QCOMPARE(spy.at(0).at(0).value<QObject *>(), &first);
+    QCOMPARE(spy.at(0).at(1).toString(), QStringLiteral("cl"));
+    QCOMPARE(spy.at(1).at(0).value<QObject *>(), &second);
+    QCOMPARE(spy.at(1).at(1).toString(), QStringLiteral("co"));
+    QVERIFY(!completion.hasCompletionRequest(&first));
+    // the requesters search the matches themselves
+    QCOMPARE(completion.statistics().matchSearches(), quint64(0));
+
+    // requests don't change the last completed string
+    completion.makeCompletion(QStringLiteral("carp"));
+    completion.requestCompletion(&first, QStringLiteral("co"));
+    QTRY_COMPARE(spy.count(), 3);
+    QCOMPARE(completion.allMatches(), (QStringList{carpet, carp}));
+
+    // nothing is delivered to destroyed requesters
+    {
+        QObject gone;
+        completion.requestCompletion(&gone, QStringLiteral("c"));
+    }
+    QTest::qWait(10);
+    QCOMPARE(spy.count(), 3);
+}
+
+void Test_KCompletion::tracing()
+{
+    KCompletion completion;
+    completion.setSoundsEnabled(false);
+    completion.setResultCacheSize(8);
+    completion.setItems(strings);
+    completion.setCompletionMode(KCompletion::CompletionPopup);
+
+    QLoggingCategory::setFilterRules(QStringLiteral("kf.completion.trace.debug=true"));
+    QTest::ignoreMessage(QtDebugMsg, QRegularExpression(QStringLiteral("^makeCompletion .*prefix length 2, \\d+ nodes visited, 2 matches extracted")));
+    QCOMPARE(completion.makeCompletion(QStringLiteral("ca")), carpet);
+    QTest::ignoreMessage(QtDebugMsg, QRegularExpression(QStringLiteral("^allMatches .*prefix length 2, .*\\(cached\\), 2 returned")));
+    QCOMPARE(completion.allMatches().count(), 2);
+    QTest::ignoreMessage(QtDebugMsg, QRegularExpression(QStringLiteral("^substringCompletion .*prefix length 3, .* 4 matches extracted, 2 returned")));
+    QCOMPARE(completion.substringCompletion(QStringLiteral("pet")).count(), 2);
+    QLoggingCategory::setFilterRules(QString());
+
+    // nothing is logged when the category is disabled
+    static QStringList messages;
+    messages.clear();
+    const QtMessageHandler previousHandler = qInstallMessageHandler([](QtMsgType, const QMessageLogContext &, const QString &message) {
+        messages.append(message);
+    });
+    completion.makeCompletion(QStringLiteral("co"));
+    completion.allMatches();
+    completion.substringCompletion(QStringLiteral("pet"));
+    qInstallMessageHandler(previousHandler);
+    QVERIFY2(messages.isEmpty(), qPrintable(messages.join(QLatin1Char('\n'))));
+}
+
+void Test_KCompletion::statistics()
+{
+    KCompletion completion;
+    completion.setSoundsEnabled(false);
+    completion.setResultCacheSize(8);
+    completion.setItems(strings);
+    completion.removeItem(carp);
+
+    KCompletion::Statistics statistics = completion.statistics();
+    QCOMPARE(statistics.treeMutations(), quint64(6)); // clear, 4 items, removal
+    QCOMPARE(statistics.queries(), quint64(0));
+    QCOMPARE(statistics.averageMatches(), 0.0);
+
+    completion.setCompletionMode(KCompletion::CompletionPopup);
+    QCOMPARE(completion.makeCompletion(QStringLiteral("c")), clampet);
+    QCOMPARE(completion.allMatches().count(), 3);
+    completion.setCompletionMode(KCompletion::CompletionShell);
+    completion.makeCompletion(QStringLiteral("ca"));
+    QCOMPARE(completion.allMatches(QStringLiteral("c"), -1).count(), 3);
+    QCOMPARE(completion.substringCompletion(QStringLiteral("o")).count(), 3);
+
+    statistics = completion.statistics();
+    QCOMPARE(statistics.completions(KCompletion::CompletionPopup), quint64(1));
+    QCOMPARE(statistics.completions(KCompletion::CompletionShell), quint64(1));
+    QCOMPARE(statistics.matchQueries(), quint64(3));
+    QCOMPARE(statistics.matchSearches(), quint64(2)); // "c" and "ca", the rest is reused
+    QCOMPARE(statistics.queries(), quint64(5));
+    QCOMPARE(statistics.totalMatches(), quint64(11));
+    QCOMPARE(statistics.maxMatches(), quint64(3));
+    QCOMPARE(statistics.averageMatches(), 11.0 / 5);
+    QCOMPARE(statistics.resultCacheHits(), completion.resultCacheHits());
+    QVERIFY(statistics.resultCacheHits() > 0);
+    QVERIFY(statistics.totalTime().count() > 0);
+
+    // the statistics taken before don't change
+    const KCompletion::Statistics before = statistics;
+    completion.resetStatistics();
+    QCOMPARE(before.queries(), quint64(5));
+    statistics = completion.statistics();
+    QCOMPARE(statistics.queries(), quint64(0));
+    QCOMPARE(statistics.treeMutations(), quint64(0));
+    QCOMPARE(statistics.totalTime().count(), std::chrono::nanoseconds::rep(0));
+    QCOMPARE(completion.resultCacheHits(), quint64(0));
+    QCOMPARE(completion.resultCacheMisses(), quint64(0));
+}
+
 QTEST_MAIN(Test_KCompletion)
 
 #include "moc_kcompletioncoretest.cpp"
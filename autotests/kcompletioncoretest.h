@@ -32,6 +32,23 @@ private Q_SLOTS:
     void cycleMatches_Insertion();
     void cycleMatches_Sorted();
     void cycleMatches_Weighted();
+    void itemInterning();
+    void deepTree();
+    void wideTree();
+    void parallelInsertion_data();
+    void parallelInsertion();
+    void parallelScans_data();
+    void parallelScans();
+    void weightedMatchesLimit();
+    void streamMatches();
+    void streamCompletedMatches();
+    void resultCache();
+    void resultCacheSorterFunction();
+    void allMatchesLimit();
+    void fetchMatchesOnDemand();
+    void completionRequests();
+    void tracing();
+    void statistics();
 };
 
 #endif
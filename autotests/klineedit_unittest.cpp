@@ -8,11 +8,58 @@
 
 #include <QClipboard>
 #include <QSignalSpy>
+#include <QStyle>
 #include <QTest>
 #include <QToolButton>
+#include <QVBoxLayout>
+#include <kcompletion.h>
 #include <kcompletionbox.h>
 #include <klineedit.h>
 
+class FilterCountingCompletionBox : public KCompletionBox
+{
+public:
+    using KCompletionBox::KCompletionBox;
+
+    int filteredEvents = 0;
+
+protected:
+    bool eventFilter(QObject *o, QEvent *e) override
+    {
+        ++filteredEvents;
+        return KCompletionBox::eventFilter(o, e);
+    }
+};
+
+// Records the strings makeCompletion() is called with, like KUrlCompletion starts its listings there
+class RecordingCompletion : public KCompletion
+{
+public:
+    QStringList completedStrings;
+
+    QString makeCompletion(const QString &string) override
+    {
+        completedStrings.append(string);
+        return KCompletion::makeCompletion(string);
+    }
+};
+
+class PostedEventCounter : public QObject
+{
+public:
+    int receivedEvents = 0;
+
+protected:
+    bool event(QEvent *e) override
+    {
+        if (e->type() == QEvent::User) {
+            ++receivedEvents;
+            return true;
+        }
+        return QObject::event(e);
+    }
+};
+
 class KLineEdit_UnitTest : public QObject
 {
     Q_OBJECT
@@ -201,6 +248,347 @@ private Q_SLOTS:
         QCOMPARE(w.text(), newItems.at(0));
     }
 
+    void testCompletionDelay()
+    {
+        KLineEdit w;
+        w.setText(QStringLiteral("/"));
+        w.setCompletionMode(KCompletion::CompletionPopup);
+        w.setCompletionDelay(100);
+        QCOMPARE(w.completionDelay(), 100);
+        RecordingCompletion completion;
+        completion.setSoundsEnabled(false);
+        w.setCompletionObject(&completion);
+        const QStringList items{QStringLiteral("/home/"), QStringLiteral("/hold/"), QStringLiteral("/hole/"), QStringLiteral("/house/")};
+        completion.setItems(items);
+
+        // the first change is completed right away
+        QTest::keyClick(&w, 'h');
+        QCOMPARE(w.completionBox()->items(), items);
+
+        // the next ones only once the delay is over, all at once
+        QTest::keyClick(&w, 'o');
+        QTest::keyClick(&w, 'l');
+        QCOMPARE(w.text(), QStringLiteral("/hol"));
+        QCOMPARE(w.completionBox()->items(), items);
+        QTRY_COMPARE(w.completionBox()->items(), QStringList({QStringLiteral("/hold/"), QStringLiteral("/hole/")}));
+        QCOMPARE(completion.completedStrings, QStringList({QStringLiteral("/h"), QStringLiteral("/hol")}));
+        QCOMPARE(w.compObj()->nextMatch(), QStringLiteral("/hole/"));
+
+        // cancelling drops a pending completion
+        QTest::keyClick(&w, 'e');
+        QTest::keyClick(&w, Qt::Key_Escape);
+        QVERIFY(!w.completionBox()->isVisible());
+        QTest::qWait(150);
+        QVERIFY(!w.completionBox()->isVisible());
+    }
+
+    void testCompletionRequestState()
+    {
+        KLineEdit w;
+        w.setText(QStringLiteral("/"));
+        w.setCompletionMode(KCompletion::CompletionPopup);
+        w.setCompletionDelay(100);
+        RecordingCompletion completion;
+        completion.setSoundsEnabled(false);
+        w.setCompletionObject(&completion);
+        completion.setItems({QStringLiteral("/home/"), QStringLiteral("/hold/"), QStringLiteral("/hole/"), QStringLiteral("/house/")});
+        QVERIFY(w.setKeyBinding(KCompletionBase::NextCompletionMatch, {QKeySequence(Qt::CTRL | Qt::Key_J)}));
+
+        QTest::keyClick(&w, 'h');
+        QTest::keyClick(&w, 'o');
+        QTest::keyClick(&w, 'l');
+        QCOMPARE(completion.completedStrings, QStringList{QStringLiteral("/h")});
+
+        // the delayed completion goes through the override as well
+        QTRY_COMPARE(completion.completedStrings, QStringList({QStringLiteral("/h"), QStringLiteral("/hol")}));
+
+        // and the rotation continues from the delayed text
+        QTest::keyClick(&w, Qt::Key_J, Qt::ControlModifier);
+        QVERIFY(QStringList({QStringLiteral("/hold/"), QStringLiteral("/hole/")}).contains(w.text()));
+    }
+
+    void testDelayedCompletionSearches()
+    {
+        KLineEdit w;
+        w.setText(QStringLiteral("/"));
+        w.setCompletionMode(KCompletion::CompletionPopup);
+        w.setCompletionDelay(100);
+        RecordingCompletion completion;
+        completion.setSoundsEnabled(false);
+        w.setCompletionObject(&completion);
+        completion.setItems({QStringLiteral("/home/"), QStringLiteral("/hold/"), QStringLiteral("/hole/"), QStringLiteral("/house/")});
+
+        QTest::keyClick(&w, 'h');
+        const KCompletion::Statistics immediate = completion.statistics();
+        QCOMPARE(immediate.matchSearches(), quint64(1));
+
+        // a delayed completion costs as much as an immediate one
+        QTest::keyClick(&w, 'o');
+        QTest::keyClick(&w, 'l');
+        QTRY_COMPARE(completion.completedStrings.constLast(), QStringLiteral("/hol"));
+        const KCompletion::Statistics delayed = completion.statistics();
+        QCOMPARE(delayed.queries() - immediate.queries(), immediate.queries());
+        QCOMPARE(delayed.matchSearches() - immediate.matchSearches(), quint64(1));
+    }
+
+    void testKeyBindings()
+    {
+        KLineEdit w;
+        KCompletion completion;
+        completion.setSoundsEnabled(false);
+        w.setCompletionObject(&completion);
+        QSignalSpy rotationSpy(&w, &KLineEdit::textRotation);
+        QSignalSpy substringSpy(&w, &KLineEdit::substringCompletion);
+
+        QVERIFY(w.setKeyBinding(KCompletionBase::NextCompletionMatch, {QKeySequence(Qt::CTRL | Qt::Key_J)}));
+        QTest::keyClick(&w, Qt::Key_J, Qt::ControlModifier);
+        QCOMPARE(rotationSpy.count(), 1);
+
+        // changing the bindings takes effect right away
+        QVERIFY(w.setKeyBinding(KCompletionBase::NextCompletionMatch, {}));
+        QVERIFY(w.setKeyBinding(KCompletionBase::SubstringCompletion, {QKeySequence(Qt::CTRL | Qt::Key_J)}));
+        QTest::keyClick(&w, Qt::Key_J, Qt::ControlModifier);
+        QCOMPARE(rotationSpy.count(), 1);
+        QCOMPARE(substringSpy.count(), 1);
+
+        // the standard shortcuts still apply
+        w.setText(QStringLiteral("Hello"));
+        w.selectAll();
+        QTest::keySequence(&w, QKeySequence::Cut);
+        QVERIFY(w.text().isEmpty());
+    }
+
+    void testCompletionBoxLazyLoading()
+    {
+        KCompletionBox box;
+        box.setLazyLoading(true);
+        QStringList items;
+        for (int i = 0; i < 1000; ++i) {
+            items << QStringLiteral("/home/%1").arg(i);
+        }
+        box.setItems(items);
+        const int createdRows = box.count();
+        QVERIFY(createdRows < items.count());
+        QCOMPARE(box.items(), items);
+
+        // moving past the last created row creates more rows
+        box.setCurrentRow(createdRows - 1);
+        box.down();
+        QVERIFY(box.count() > createdRows);
+        QCOMPARE(box.currentRow(), createdRows);
+        QCOMPARE(box.currentItem()->text(), items.at(createdRows));
+
+        box.appendItems({QStringLiteral("/home/last")});
+        QCOMPARE(box.items(), items + QStringList{QStringLiteral("/home/last")});
+        box.end();
+        QCOMPARE(box.count(), items.count() + 1);
+        QCOMPARE(box.currentItem()->text(), QStringLiteral("/home/last"));
+
+        box.setItems(items);
+        QCOMPARE(box.count(), createdRows);
+        QCOMPARE(box.items(), items);
+        box.clear();
+        QVERIFY(box.items().isEmpty());
+
+        box.setItems(items);
+        box.setLazyLoading(false);
+        QCOMPARE(box.count(), items.count());
+        QCOMPARE(box.items(), items);
+    }
+
+    void testCompletionBoxFetchLastRows()
+    {
+        KCompletionBox box;
+        box.setItems({QStringLiteral("a0"), QStringLiteral("a1")});
+        box.setCanFetchMore(true);
+        // an engine that never runs out of items
+        int requests = 0;
+        connect(&box, &KCompletionBox::fetchMoreRequested, &box, [&]() {
+            ++requests;
+            box.appendItems({QStringLiteral("b%1").arg(requests), QStringLiteral("c%1").arg(requests)});
+        });
+
+        // End and Up on the first row request a single chunk
+        box.end();
+        QCOMPARE(requests, 1);
+        QCOMPARE(box.count(), 4);
+        QCOMPARE(box.currentItem()->text(), QStringLiteral("c1"));
+
+        box.setCurrentRow(0);
+        box.up();
+        QCOMPARE(requests, 2);
+        QCOMPARE(box.count(), 6);
+        QCOMPARE(box.currentItem()->text(), QStringLiteral("c2"));
+    }
+
+    void testCompletionBoxSetItems()
+    {
+        KCompletionBox box;
+        const QStringList items{QStringLiteral("ab"), QStringLiteral("abc"), QStringLiteral("abd"), QStringLiteral("abcd"), QStringLiteral("abce")};
+        box.setItems(items);
+        box.setCurrentRow(3);
+        QListWidgetItem *current = box.currentItem();
+
+        QSignalSpy removedSpy(box.model(), &QAbstractItemModel::rowsRemoved);
+        QSignalSpy insertedSpy(box.model(), &QAbstractItemModel::rowsInserted);
+        QSignalSpy changedSpy(box.model(), &QAbstractItemModel::dataChanged);
+
+        // narrowing removes the rows in between as one range, the others stay
+        box.setItems({QStringLiteral("abc"), QStringLiteral("abcd"), QStringLiteral("abce")});
+        QCOMPARE(removedSpy.count(), 2);
+        QCOMPARE(removedSpy.at(1).at(1).toInt(), 0);
+        QCOMPARE(removedSpy.at(0).at(1).toInt(), 2);
+        QCOMPARE(insertedSpy.count(), 0);
+        QCOMPARE(changedSpy.count(), 0);
+        QCOMPARE(box.currentItem(), current);
+        QCOMPARE(box.currentRow(), 1);
+
+        // new texts are inserted as one range
+        removedSpy.clear();
+        box.setItems({QStringLiteral("abc"), QStringLiteral("abca"), QStringLiteral("abcb"), QStringLiteral("abcd"), QStringLiteral("abce")});
+        QCOMPARE(removedSpy.count(), 0);
+        QCOMPARE(insertedSpy.count(), 1);
+        QCOMPARE(insertedSpy.at(0).at(1).toInt(), 1);
+        QCOMPARE(insertedSpy.at(0).at(2).toInt(), 2);
+        QCOMPARE(box.currentItem(), current);
+        QCOMPARE(box.currentRow(), 3);
+
+        // only the item that changed its place is moved
+        const QStringList reordered{QStringLiteral("abcd"), QStringLiteral("abc"), QStringLiteral("abca"), QStringLiteral("abcb"), QStringLiteral("abce")};
+        QListWidgetItem *last = box.item(4);
+        box.setItems(reordered);
+        QCOMPARE(box.items(), reordered);
+        QCOMPARE(removedSpy.count(), 1);
+        QCOMPARE(box.currentItem(), current);
+        QCOMPARE(box.currentRow(), 0);
+        QCOMPARE(box.item(4), last);
+        QCOMPARE(changedSpy.count(), 0);
+
+        // the current item is gone
+        box.setItems({QStringLiteral("abc"), QStringLiteral("abce")});
+        QCOMPARE(box.currentRow(), -1);
+        QVERIFY(!box.currentItem());
+
+        // duplicated texts are still shown
+        box.setItems({QStringLiteral("ab"), QStringLiteral("ab")});
+        QCOMPARE(box.items(), QStringList({QStringLiteral("ab"), QStringLiteral("ab")}));
+    }
+
+    void testCompletionBoxGeometry()
+    {
+        KLineEdit w;
+        w.show();
+        KCompletionBox *box = w.completionBox();
+        box->setItems({QStringLiteral("a"), QStringLiteral("b")});
+        box->popup();
+        QVERIFY(box->isVisible());
+        const int twoRows = box->height();
+
+        // several changes in a row are applied at once, later on
+        box->setItems({QStringLiteral("a"), QStringLiteral("b"), QStringLiteral("c"), QStringLiteral("d")});
+        box->appendItems({QStringLiteral("e")});
+        QCOMPARE(box->height(), twoRows);
+        QTRY_COMPARE(box->height(), box->sizeHint().height());
+        QVERIFY(box->height() > twoRows);
+
+        // the row height is recalculated for a bigger font
+        const int fiveRows = box->height();
+        QFont font = box->font();
+        font.setPointSize(font.pointSize() * 3);
+        box->setFont(font);
+        QTRY_VERIFY(box->height() > fiveRows);
+        QCOMPARE(box->height(), box->sizeHint().height());
+    }
+
+    void testCompletionBoxEventFilters()
+    {
+        KLineEdit w;
+        w.show();
+        QVERIFY(QTest::qWaitForWindowExposed(&w));
+        auto *box = new FilterCountingCompletionBox(&w);
+        w.setCompletionBox(box);
+        box->setItems({QStringLiteral("a"), QStringLiteral("b")});
+        box->popup();
+        QVERIFY(box->isVisible());
+
+        // events for unrelated objects don't go through the box
+        box->filteredEvents = 0;
+        QObject other;
+        for (int i = 0; i < 100; ++i) {
+            QEvent event(QEvent::User);
+            QCoreApplication::sendEvent(&other, &event);
+        }
+        QCOMPARE(box->filteredEvents, 0);
+
+        // keys pressed in the parent still reach the box
+        QTest::keyClick(&w, Qt::Key_Down);
+        QVERIFY(box->filteredEvents > 0);
+        QCOMPARE(box->currentRow(), 0);
+
+        // and clicking outside of the box hides it
+        QTest::mouseClick(&w, Qt::LeftButton);
+        QVERIFY(!box->isVisible());
+
+        box->filteredEvents = 0;
+        QTest::keyClick(&w, Qt::Key_Down);
+        QCOMPARE(box->filteredEvents, 0);
+    }
+
+    void testCompletionBoxShowDuringRelayout()
+    {
+        QWidget window;
+        auto *layout = new QVBoxLayout(&window);
+        auto *w = new KLineEdit(&window);
+        layout->addWidget(w);
+        window.show();
+        QVERIFY(QTest::qWaitForWindowExposed(&window));
+
+        // a pending relayout moves and resizes the line edit while the box is shown
+        layout->insertWidget(0, new QToolButton(&window));
+        PostedEventCounter counter;
+        QCoreApplication::postEvent(&counter, new QEvent(QEvent::User));
+
+        KCompletionBox *box = w->completionBox();
+        box->setItems({QStringLiteral("a"), QStringLiteral("b")});
+        box->popup();
+        QVERIFY(box->isVisible());
+        QCOMPARE(box->width(), w->width());
+        // the events of unrelated objects are left to the event loop
+        QCOMPARE(counter.receivedEvents, 0);
+
+        QCoreApplication::processEvents();
+        QCOMPARE(counter.receivedEvents, 1);
+        QVERIFY(box->isVisible());
+    }
+
+    void testSqueezedText()
+    {
+        KLineEdit w;
+        w.show();
+        w.resize(200, w.sizeHint().height());
+        const QString fullText = QStringLiteral("/home/user/").repeated(20) + QStringLiteral("file.txt");
+        w.setReadOnly(true);
+        w.setSqueezedText(fullText);
+
+        const QString squeezed = w.text();
+        const int letters = squeezed.indexOf(QLatin1String("..."));
+        QVERIFY(letters >= 5);
+        QCOMPARE(squeezed, fullText.left(letters) + QLatin1String("...") + fullText.right(letters));
+        QCOMPARE(w.toolTip(), fullText);
+
+        // as many letters as fit are kept
+        const int labelWidth = w.width() - 2 * w.style()->pixelMetric(QStyle::PM_DefaultFrameWidth) - 2;
+        const QFontMetrics fm(w.fontMetrics());
+        QVERIFY(fm.boundingRect(squeezed).width() <= labelWidth);
+        QVERIFY(fm.boundingRect(fullText.left(letters + 1) + QLatin1String("...") + fullText.right(letters + 1)).width() > labelWidth);
+
+        // wide enough for everything
+        w.resize(fm.boundingRect(fullText).width() + 100, w.height());
+        QCOMPARE(w.text(), fullText);
+        w.resize(200, w.height());
+        QCOMPARE(w.text(), squeezed);
+    }
+
     void testPaste()
     {
         const QString origText = QApplication::clipboard()->text();
@@ -1,7 +1,41 @@
+#include <QRandomGenerator>
 #include <QString>
+#include <QTest>
 #include <ksortablelist.h>
 
-int main(int /*argc*/, char ** /*argv*/)
+class KSortableListTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void sort();
+    void sortNegativeKeys();
+    void sortNonIntegralKeys();
+    void sortLarge_data();
+    void sortLarge();
+};
+
+static QStringList values(const KSortableList<QString> &list)
+{
+    QStringList result;
+    for (const KSortableItem<QString> &item : list) {
+        result.append(item.value());
+    }
+    return result;
+}
+
+static KSortableList<QString> randomList(int count, int maxKey)
+{
+    QRandomGenerator generator(42);
+    KSortableList<QString> list;
+    list.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        list.insert(generator.bounded(maxKey), QString::number(i));
+    }
+    return list;
+}
+
+void KSortableListTest::sort()
 {
     KSortableList<QString> list;
     list.insert(1, QStringLiteral("FOO           (1)"));
@@ -12,23 +46,71 @@ int main(int /*argc*/, char ** /*argv*/)
     list.insert(2, QStringLiteral("I was here :) (2)"));
     list.insert(4, QStringLiteral("Yeehaa...     (4)"));
 
-    QList<KSortableItem<QString>>::iterator it = list.begin();
+    list.sort();
+
+    QCOMPARE(values(list),
+             QStringList({QStringLiteral("FOO           (1)"),
+                          QStringLiteral("Huba!         (1)"),
+                          QStringLiteral("Test          (2)"),
+                          QStringLiteral("I was here :) (2)"),
+                          QStringLiteral("Yeehaa...     (4)"),
+                          QStringLiteral("MAAOOAM!      (5)"),
+                          QStringLiteral("Teeheeest    (10)")}));
+}
 
-    qDebug("Insertion order:");
-    qDebug("================");
-    for (; it != list.end(); ++it) {
-        qDebug("%i: %s", (*it).key(), (*it).value().toLatin1().constData());
+void KSortableListTest::sortNegativeKeys()
+{
+    KSortableList<QString> list;
+    for (int i = 0; i < 1000; ++i) {
+        list.insert((i % 2 ? -1 : 1) * (i % 300), QString::number(i));
     }
+    KSortableList<QString> expected = list;
+    std::stable_sort(expected.begin(), expected.end());
 
     list.sort();
+    QCOMPARE(values(list), values(expected));
+}
+
+void KSortableListTest::sortNonIntegralKeys()
+{
+    KSortableList<int, QString> list;
+    list.insert(QStringLiteral("b"), 1);
+    list.insert(QStringLiteral("a"), 2);
+    list.insert(QStringLiteral("b"), 3);
+    list.insert(QStringLiteral("a"), 4);
 
-    qDebug("\nSorted:");
-    qDebug("=======");
+    list.sort();
 
-    it = list.begin();
-    for (; it != list.end(); ++it) {
-        qDebug("%i: %s", (*it).key(), (*it).value().toLatin1().constData());
+    QList<int> result;
+    for (const KSortableItem<int, QString> &item : std::as_const(list)) {
+        result.append(item.value());
     }
+    QCOMPARE(result, QList<int>({2, 4, 1, 3}));
+}
+
+void KSortableListTest::sortLarge_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<int>("maxKey");
 
-    return 0;
+    QTest::newRow("few keys") << 10000 << 10;
+    QTest::newRow("many keys") << 10000 << 1000000;
+    QTest::newRow("below radix threshold") << 100 << 1000;
 }
+
+void KSortableListTest::sortLarge()
+{
+    QFETCH(int, count);
+    QFETCH(int, maxKey);
+
+    KSortableList<QString> list = randomList(count, maxKey);
+    KSortableList<QString> expected = list;
+    std::stable_sort(expected.begin(), expected.end());
+
+    list.sort();
+    QCOMPARE(values(list), values(expected));
+}
+
+QTEST_GUILESS_MAIN(KSortableListTest)
+
+#include "ksortablelisttest.moc"
@@ -0,0 +1,274 @@
+/*
+    This file is part of the KDE libraries
+
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "benchmarkcorpus.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QRandomGenerator>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+const QStringList s_words = {
+    QStringLiteral("alpha"),
+    QStringLiteral("build"),
+    QStringLiteral("config"),
+    QStringLiteral("data"),
+    QStringLiteral("desktop"),
+    QStringLiteral("doc"),
+    QStringLiteral("export"),
+    QStringLiteral("files"),
+    QStringLiteral("git"),
+    QStringLiteral("home"),
+    QStringLiteral("images"),
+    QStringLiteral("kde"),
+    QStringLiteral("library"),
+    QStringLiteral("local"),
+    QStringLiteral("music"),
+    QStringLiteral("notes"),
+    QStringLiteral("plasma"),
+    QStringLiteral("project"),
+    QStringLiteral("release"),
+    QStringLiteral("share"),
+    QStringLiteral("source"),
+    QStringLiteral("src"),
+    QStringLiteral("test"),
+    QStringLiteral("tmp"),
+    QStringLiteral("usr"),
+    QStringLiteral("Videos"),
+    QStringLiteral("widgets"),
+    QStringLiteral("Work"),
+    QStringLiteral("xdg"),
+    QStringLiteral("zone"),
+};
+
+const QStringList s_extensions = {
+    QStringLiteral("cpp"),
+    QStringLiteral("h"),
+    QStringLiteral("txt"),
+    QStringLiteral("png"),
+    QStringLiteral("json"),
+    QStringLiteral("md"),
+};
+
+const QStringList s_hosts = {
+    QStringLiteral("kde.org"),
+    QStringLiteral("invent.kde.org"),
+    QStringLiteral("api.kde.org"),
+    QStringLiteral("example.com"),
+    QStringLiteral("qt.io"),
+    QStringLiteral("wikipedia.org"),
+};
+
+const QStringList s_commands = {
+    QStringLiteral("cmake"),
+    QStringLiteral("git"),
+    QStringLiteral("grep"),
+    QStringLiteral("kate"),
+    QStringLiteral("ls"),
+    QStringLiteral("make"),
+    QStringLiteral("ssh"),
+    QStringLiteral("tar"),
+};
+
+const QStringList s_options = {
+    QStringLiteral("-a"),
+    QStringLiteral("--build"),
+    QStringLiteral("--color"),
+    QStringLiteral("-j8"),
+    QStringLiteral("-l"),
+    QStringLiteral("--verbose"),
+    QStringLiteral("-xzf"),
+};
+
+const QString &pick(QRandomGenerator &random, const QStringList &list)
+{
+    return list.at(random.bounded(int(list.count())));
+}
+
+// The index makes every item distinct, while the words give them common prefixes
+QString makeItem(BenchmarkCorpus::Kind kind, QRandomGenerator &random, int index)
+{
+    const QString id = QString::number(index, 36);
+    switch (kind) {
+    case BenchmarkCorpus::Paths:
+        return QLatin1Char('/') + pick(random, s_words) + QLatin1Char('/') + pick(random, s_words) + QLatin1Char('/') + pick(random, s_words)
+            + QLatin1Char('/') + pick(random, s_words) + id + QLatin1Char('.') + pick(random, s_extensions);
+    case BenchmarkCorpus::Urls:
+        return QLatin1String(random.bounded(4) ? "https://" : "http://") + pick(random, s_hosts) + QLatin1Char('/') + pick(random, s_words)
+            + QLatin1Char('/') + pick(random, s_words) + QLatin1String("?id=") + id;
+    case BenchmarkCorpus::ShellCommands:
+        return pick(random, s_commands) + QLatin1Char(' ') + pick(random, s_options) + QLatin1Char(' ') + pick(random, s_words) + QLatin1Char('/')
+            + pick(random, s_words) + id;
+    case BenchmarkCorpus::EmailAddresses:
+        return pick(random, s_words) + QLatin1Char('.') + pick(random, s_words) + id + QLatin1Char('@') + pick(random, s_hosts);
+    case BenchmarkCorpus::HostNames: {
+        static const QLatin1String labelChars("abcdefghijklmnopqrstuvwxyz0123456789-");
+        QString label;
+        const int length = 3 + random.bounded(10);
+        for (int i = 0; i < length; ++i) {
+            // no leading hyphen
+            label += labelChars.at(random.bounded(int(labelChars.size()) - (i == 0 ? 1 : 0)));
+        }
+        return label + id + QLatin1Char('.') + pick(random, s_hosts);
+    }
+    case BenchmarkCorpus::HexHashes: {
+        QString hash;
+        for (int i = 0; i < 40; ++i) {
+            hash += QLatin1Char("0123456789abcdef"[random.bounded(16)]);
+        }
+        // the index keeps them distinct
+        return hash + id;
+    }
+    }
+    return id;
+}
+
+qint64 readStatusKiB(const char *field)
+{
+#ifdef Q_OS_LINUX
+    QFile file(QStringLiteral("/proc/self/status"));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    const QByteArray prefix = QByteArray(field) + ':';
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    for (const QByteArray &line : lines) {
+        if (line.startsWith(prefix)) {
+            // e.g. "VmHWM:     1234 kB"
+            return line.mid(prefix.size()).trimmed().split(' ').constFirst().toLongLong();
+        }
+    }
+#else
+    Q_UNUSED(field);
+#endif
+    return -1;
+}
+}
+
+QList<BenchmarkCorpus::Kind> BenchmarkCorpus::kinds()
+{
+    return {Paths, Urls, ShellCommands, EmailAddresses};
+}
+
+QList<BenchmarkCorpus::Kind> BenchmarkCorpus::fanOutKinds()
+{
+    return {HostNames, HexHashes};
+}
+
+const char *BenchmarkCorpus::kindName(Kind kind)
+{
+    switch (kind) {
+    case Paths:
+        return "paths";
+    case Urls:
+        return "urls";
+    case ShellCommands:
+        return "commands";
+    case EmailAddresses:
+        return "emails";
+    case HostNames:
+        return "hostnames";
+    case HexHashes:
+        return "hashes";
+    }
+    return "";
+}
+
+QList<int> BenchmarkCorpus::sizes()
+{
+    bool ok = false;
+    int maxItems = qEnvironmentVariableIntValue("KCOMPLETION_BENCHMARK_MAX_ITEMS", &ok);
+    if (!ok) {
+        maxItems = 100000;
+    }
+
+    QList<int> sizes;
+    for (int size : {1000, 10000, 100000, 1000000, 5000000}) {
+        if (size <= maxItems || sizes.isEmpty()) {
+            sizes.append(size);
+        }
+    }
+    return sizes;
+}
+
+QStringList BenchmarkCorpus::items(Kind kind, int count)
+{
+    QRandomGenerator random(quint32(kind) + 1);
+    QStringList items;
+    items.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        items.append(makeItem(kind, random, i));
+    }
+    return items;
+}
+
+QStringList BenchmarkCorpus::weightedItems(const QStringList &items)
+{
+    QRandomGenerator random(quint32(items.count()));
+    QStringList weightedItems;
+    weightedItems.reserve(items.count());
+    for (const QString &item : items) {
+        // Zipf-like: the weight of the k-th most popular item is about 1/k of the most popular one
+        const uint weight = 1000000 / (1 + random.bounded(int(items.count())));
+        weightedItems.append(item + QLatin1Char(':') + QString::number(weight));
+    }
+    return weightedItems;
+}
+
+QStringList BenchmarkCorpus::queries(const QStringList &items, int count, quint32 seed)
+{
+    QRandomGenerator random(seed);
+    QStringList queries;
+    if (items.isEmpty()) {
+        return queries;
+    }
+    queries.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const QString &item = pick(random, items);
+        // most of the time only the first few characters are typed
+        const int length = 1 + std::min(int(item.length()) - 1, int(std::abs(random.generateDouble() - random.generateDouble()) * item.length()));
+        queries.append(item.left(length));
+    }
+    return queries;
+}
+
+qint64 BenchmarkCorpus::peakMemoryKiB()
+{
+    return readStatusKiB("VmHWM");
+}
+
+qint64 BenchmarkCorpus::currentMemoryKiB()
+{
+    return readStatusKiB("VmRSS");
+}
+
+qint64 LatencyStats::percentile(double percent) const
+{
+    if (m_samples.isEmpty()) {
+        return 0;
+    }
+    if (!m_sorted) {
+        std::sort(m_samples.begin(), m_samples.end());
+        m_sorted = true;
+    }
+    const qsizetype index = std::min(m_samples.count() - 1, qsizetype(std::ceil(percent / 100.0 * m_samples.count())) - 1);
+    return m_samples.at(std::max<qsizetype>(0, index));
+}
+
+void LatencyStats::report(const QString &name) const
+{
+    const auto micros = [this](double percent) {
+        return QString::number(percentile(percent) / 1000.0, 'f', 1);
+    };
+    qInfo().noquote() << name << QStringLiteral("operations: %1 p50: %2us p90: %3us p99: %4us max: %5us")
+                                     .arg(QString::number(m_samples.count()), micros(50), micros(90), micros(99), micros(100));
+}
@@ -0,0 +1,83 @@
+/*
+    This file is part of the KDE libraries
+
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef BENCHMARKCORPUS_H
+#define BENCHMARKCORPUS_H
+
+#include <QList>
+#include <QStringList>
+
+/*
+ * Synthetic, reproducible data for the benchmarks: the same kind, count and
+ * seed always give the same items.
+ */
+namespace BenchmarkCorpus
+{
+enum Kind {
+    Paths,
+    Urls,
+    ShellCommands,
+    EmailAddresses,
+    // many different characters at the same position, i.e. nodes with many children
+    HostNames,
+    HexHashes,
+};
+
+QList<Kind> kinds();
+// The kinds with a high fan-out, not part of kinds()
+QList<Kind> fanOutKinds();
+const char *kindName(Kind kind);
+
+// The corpus sizes to benchmark, from 1000 items up to the value of the
+// KCOMPLETION_BENCHMARK_MAX_ITEMS environment variable (default 100000, at most 5000000)
+QList<int> sizes();
+
+// Returns count distinct items of kind
+QStringList items(Kind kind, int count);
+
+// Returns items with a "item:weight" suffix, a few of them weighted a lot more than the rest
+QStringList weightedItems(const QStringList &items);
+
+// Returns count prefixes of randomly picked items, as typed when completing them
+QStringList queries(const QStringList &items, int count, quint32 seed = 1);
+
+// The peak resident memory of the process in KiB, or -1 if unknown
+qint64 peakMemoryKiB();
+// The current resident memory of the process in KiB, or -1 if unknown
+qint64 currentMemoryKiB();
+}
+
+/*
+ * Collects the durations of single operations and reports their distribution.
+ */
+class LatencyStats
+{
+public:
+    void add(qint64 nsecs)
+    {
+        m_samples.append(nsecs);
+        m_sorted = false;
+    }
+
+    int count() const
+    {
+        return int(m_samples.count());
+    }
+
+    // Returns the duration in nanoseconds that percentile percent of the operations did not exceed
+    qint64 percentile(double percent) const;
+
+    // Prints the percentiles of the operations as name
+    void report(const QString &name) const;
+
+private:
+    mutable QList<qint64> m_samples;
+    mutable bool m_sorted = false;
+};
+
+#endif
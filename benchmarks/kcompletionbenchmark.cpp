@@ -0,0 +1,551 @@
+/*
+    This file is part of the KDE libraries
+
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "benchmarkcorpus.h"
+
+#include <KCompletion>
+#include <KCompletionMatches>
+#include <KSortableList>
+
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTest>
+
+/*
+ * Measures the completion core on synthetic corpora, see BenchmarkCorpus.
+ *
+ * Besides the QBENCHMARK results, every benchmark prints the latency
+ * percentiles of the single operations, e.g. of each makeCompletion() call.
+ * Set KCOMPLETION_BENCHMARK_MAX_ITEMS to benchmark larger corpora, and
+ * KCOMPLETION_NO_SIMD to look up the children of the tree nodes without
+ * SSE2 or AVX2.
+ */
+class KCompletionBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void insertItems_data();
+    void insertItems();
+    void makeCompletion_data();
+    void makeCompletion();
+    void allMatches_data();
+    void allMatches();
+    void allWeightedMatches_data();
+    void allWeightedMatches();
+    void extraction_data();
+    void extraction();
+    void substringCompletion_data();
+    void substringCompletion();
+    void ignoreCase_data();
+    void ignoreCase();
+    void childLookup_data();
+    void childLookup();
+    void removeItem_data();
+    void removeItem();
+    void clear_data();
+    void clear();
+    void memory_data();
+    void memory();
+    void sortableListSort_data();
+    void sortableListSort();
+
+private:
+    // Returns the items of the current test data, generated only once per corpus
+    const QStringList &corpus();
+
+    std::pair<int, int> m_corpusKey{-1, -1};
+    QStringList m_corpus;
+};
+
+namespace
+{
+// Each benchmark runs this many queries against a corpus
+constexpr int s_queryCount = 1000;
+// ... except for the ones scanning every item
+constexpr int s_scanQueryCount = 50;
+
+void addCorpusColumns()
+{
+    QTest::addColumn<int>("kind");
+    QTest::addColumn<int>("size");
+}
+
+void addCorpusRows()
+{
+    addCorpusColumns();
+    const QList<int> sizes = BenchmarkCorpus::sizes();
+    for (BenchmarkCorpus::Kind kind : BenchmarkCorpus::kinds()) {
+        for (int size : sizes) {
+            QTest::addRow("%s/%d", BenchmarkCorpus::kindName(kind), size) << int(kind) << size;
+        }
+    }
+}
+
+QString reportName()
+{
+    return QLatin1String(QTest::currentTestFunction()) + QLatin1Char('(') + QLatin1String(QTest::currentDataTag()) + QLatin1Char(')');
+}
+}
+
+const QStringList &KCompletionBenchmark::corpus()
+{
+    QFETCH(int, kind);
+    QFETCH(int, size);
+    const std::pair<int, int> key(kind, size);
+    if (m_corpusKey != key) {
+        m_corpus.clear();
+        m_corpus = BenchmarkCorpus::items(BenchmarkCorpus::Kind(kind), size);
+        m_corpusKey = key;
+    }
+    return m_corpus;
+}
+
+void KCompletionBenchmark::insertItems_data()
+{
+    addCorpusRows();
+}
+
+void KCompletionBenchmark::insertItems()
+{
+    const QStringList &items = corpus();
+    // measured in chunks, as the cost of an insertion grows with the tree
+    constexpr int chunkSize = 1000;
+    QList<QStringList> chunks;
+    for (qsizetype i = 0; i < items.count(); i += chunkSize) {
+        chunks.append(items.mid(i, chunkSize));
+    }
+
+    LatencyStats stats;
+    QElapsedTimer timer;
+    QBENCHMARK {
+        KCompletion completion;
+        for (const QStringList &chunk : std::as_const(chunks)) {
+            timer.start();
+            completion.insertItems(chunk);
+            stats.add(timer.nsecsElapsed());
+        }
+    }
+    stats.report(reportName());
+}
+
+void KCompletionBenchmark::makeCompletion_data()
+{
+    addCorpusColumns();
+    QTest::addColumn<KCompletion::CompletionMode>("mode");
+
+    const QList<std::pair<const char *, KCompletion::CompletionMode>> modes = {
+        {"auto", KCompletion::CompletionAuto},
+        {"man", KCompletion::CompletionMan},
+        {"shell", KCompletion::CompletionShell},
+        {"popup", KCompletion::CompletionPopup},
+    };
+    const QList<int> sizes = BenchmarkCorpus::sizes();
+    for (BenchmarkCorpus::Kind kind : BenchmarkCorpus::kinds()) {
+        for (int size : sizes) {
+            for (const auto &[name, mode] : modes) {
+                QTest::addRow("%s/%d/%s", BenchmarkCorpus::kindName(kind), size, name) << int(kind) << size << mode;
+            }
+        }
+    }
+}
+
+void KCompletionBenchmark::makeCompletion()
+{
+    QFETCH(KCompletion::CompletionMode, mode);
+    const QStringList &items = corpus();
+    const QStringList queries = BenchmarkCorpus::queries(items, s_queryCount);
+
+    KCompletion completion;
+    completion.setSoundsEnabled(false);
+    completion.setCompletionMode(mode);
+    completion.insertItems(items);
+
+    LatencyStats stats;
+    QElapsedTimer timer;
+    QBENCHMARK {
+        for (const QString &query : queries) {
+            timer.start();
+            completion.makeCompletion(query);
+            stats.add(timer.nsecsElapsed());
+        }
+    }
+    stats.report(reportName());
+}
+
+void KCompletionBenchmark::allMatches_data()
+{
+    addCorpusRows();
+}
+
+void KCompletionBenchmark::allMatches()
+{
+    const QStringList &items = corpus();
+    const QStringList queries = BenchmarkCorpus::queries(items, s_queryCount);
+
+    KCompletion completion;
+    completion.insertItems(items);
+
+    LatencyStats stats;
+    QElapsedTimer timer;
+    QBENCHMARK {
+        for (const QString &query : queries) {
+            timer.start();
+            completion.allMatches(query);
+            stats.add(timer.nsecsElapsed());
+        }
+    }
+    stats.report(reportName());
+}
+
+void KCompletionBenchmark::allWeightedMatches_data()
+{
+    addCorpusRows();
+}
+
+void KCompletionBenchmark::allWeightedMatches()
+{
+    const QStringList &items = corpus();
+    const QStringList queries = BenchmarkCorpus::queries(items, s_queryCount);
+
+    KCompletion completion;
+    completion.setOrder(KCompletion::Weighted);
+    completion.insertItems(BenchmarkCorpus::weightedItems(items));
+
+    LatencyStats stats;
+    QElapsedTimer timer;
+    QBENCHMARK {
+        for (const QString &query : queries) {
+            timer.start();
+            completion.allWeightedMatches(query);
+            stats.add(timer.nsecsElapsed());
+        }
+    }
+    stats.report(reportName());
+}
+
+void KCompletionBenchmark::extraction_data()
+{
+    addCorpusColumns();
+    QTest::addColumn<KCompletion::CompOrder>("order");
+    QTest::addColumn<bool>("interning");
+
+    const QList<std::pair<const char *, KCompletion::CompOrder>> orders = {
+        {"insertion", KCompletion::Insertion},
+        {"sorted", KCompletion::Sorted},
+        {"weighted", KCompletion::Weighted},
+    };
+    const QList<int> sizes = BenchmarkCorpus::sizes();
+    for (BenchmarkCorpus::Kind kind : BenchmarkCorpus::kinds()) {
+        for (int size : sizes) {
+            for (const auto &[name, order] : orders) {
+                QTest::addRow("%s/%d/%s", BenchmarkCorpus::kindName(kind), size, name) << int(kind) << size << order << false;
+                QTest::addRow("%s/%d/%s/interned", BenchmarkCorpus::kindName(kind), size, name) << int(kind) << size << order << true;
+            }
+        }
+    }
+}
+
+void KCompletionBenchmark::extraction()
+{
+    QFETCH(KCompletion::CompOrder, order);
+    QFETCH(bool, interning);
+    const QStringList &items = corpus();
+    // short prefixes, so that every query extracts a large part of the tree
+    QStringList queries = BenchmarkCorpus::queries(items, s_scanQueryCount);
+    for (QString &query : queries) {
+        query.truncate(2);
+    }
+
+    KCompletion completion;
+    completion.setOrder(order);
+    completion.setItemInterning(interning);
+    // extract the matches for every query instead of taking them from the cache
+    completion.setResultCacheSize(0);
+    completion.insertItems(order == KCompletion::Weighted ? BenchmarkCorpus::weightedItems(items) : items);
+
+    LatencyStats stats;
+    QElapsedTimer timer;
+    qint64 totalNsecs = 0;
+    qint64 totalMatches = 0;
+    QBENCHMARK {
+        for (const QString &query : std::as_const(queries)) {
+            timer.start();
+            const qsizetype matches = completion.allMatches(query).count();
+            const qint64 elapsed = timer.nsecsElapsed();
+            stats.add(elapsed);
+            totalNsecs += elapsed;
+            totalMatches += matches;
+        }
+        // items() adds the weights to the strings in Weighted order
+        timer.start();
+        const qsizetype allItems = completion.items().count();
+        const qint64 elapsed = timer.nsecsElapsed();
+        stats.add(elapsed);
+        totalNsecs += elapsed;
+        totalMatches += allItems;
+    }
+    stats.report(reportName());
+    qInfo().noquote() << reportName()
+                      << QStringLiteral("matches: %1 per match: %2ns")
+                             .arg(QString::number(totalMatches), QString::number(qreal(totalNsecs) / std::max<qint64>(1, totalMatches), 'f', 1));
+}
+
+void KCompletionBenchmark::substringCompletion_data()
+{
+    addCorpusColumns();
+    QTest::addColumn<bool>("parallel");
+
+    const QList<int> sizes = BenchmarkCorpus::sizes();
+    for (BenchmarkCorpus::Kind kind : BenchmarkCorpus::kinds()) {
+        for (int size : sizes) {
+            QTest::addRow("%s/%d/serial", BenchmarkCorpus::kindName(kind), size) << int(kind) << size << false;
+            QTest::addRow("%s/%d/parallel", BenchmarkCorpus::kindName(kind), size) << int(kind) << size << true;
+        }
+    }
+}
+
+void KCompletionBenchmark::substringCompletion()
+{
+    QFETCH(bool, parallel);
+    const QStringList &items = corpus();
+    QStringList queries = BenchmarkCorpus::queries(items, s_scanQueryCount);
+    // look for the middle part of the items rather than their beginning
+    for (QString &query : queries) {
+        query = query.mid(query.length() / 2);
+    }
+
+    KCompletion completion;
+    // scans every item on all threads of the pool
+    completion.setParallelThreshold(parallel ? 1 : 0);
+    completion.insertItems(items);
+
+    LatencyStats stats;
+    QElapsedTimer timer;
+    QBENCHMARK {
+        for (const QString &query : std::as_const(queries)) {
+            timer.start();
+            completion.substringCompletion(query);
+            stats.add(timer.nsecsElapsed());
+        }
+    }
+    stats.report(reportName());
+}
+
+void KCompletionBenchmark::ignoreCase_data()
+{
+    addCorpusColumns();
+    QTest::addColumn<bool>("ignoreCase");
+
+    const QList<int> sizes = BenchmarkCorpus::sizes();
+    for (BenchmarkCorpus::Kind kind : BenchmarkCorpus::kinds()) {
+        for (int size : sizes) {
+            QTest::addRow("%s/%d/cs", BenchmarkCorpus::kindName(kind), size) << int(kind) << size << false;
+            QTest::addRow("%s/%d/ci", BenchmarkCorpus::kindName(kind), size) << int(kind) << size << true;
+        }
+    }
+}
+
+void KCompletionBenchmark::ignoreCase()
+{
+    QFETCH(bool, ignoreCase);
+    const QStringList &items = corpus();
+    QStringList queries = BenchmarkCorpus::queries(items, s_queryCount);
+    if (ignoreCase) {
+        // make the case matter, the matches are the same then
+        for (QString &query : queries) {
+            query = query.toUpper();
+        }
+    }
+
+    KCompletion completion;
+    completion.setSoundsEnabled(false);
+    completion.setCompletionMode(KCompletion::CompletionShell);
+    completion.setIgnoreCase(ignoreCase);
+    completion.insertItems(items);
+
+    LatencyStats stats;
+    QElapsedTimer timer;
+    QBENCHMARK {
+        for (const QString &query : std::as_const(queries)) {
+            timer.start();
+            completion.makeCompletion(query);
+            completion.allMatches();
+            stats.add(timer.nsecsElapsed());
+        }
+    }
+    stats.report(reportName());
+}
+
+void KCompletionBenchmark::childLookup_data()
+{
+    addCorpusColumns();
+    const QList<int> sizes = BenchmarkCorpus::sizes();
+    for (BenchmarkCorpus::Kind kind : BenchmarkCorpus::fanOutKinds() + BenchmarkCorpus::kinds()) {
+        for (int size : sizes) {
+            QTest::addRow("%s/%d", BenchmarkCorpus::kindName(kind), size) << int(kind) << size;
+        }
+    }
+}
+
+void KCompletionBenchmark::childLookup()
+{
+    const QStringList &items = corpus();
+    // whole items, so that the lookup of the characters outweighs the extraction of the matches
+    const QStringList queries = BenchmarkCorpus::queries(items, s_queryCount);
+    QStringList lookups;
+    QRandomGenerator random(1);
+    for (int i = 0; i < s_queryCount; ++i) {
+        lookups.append(items.at(random.bounded(int(items.count()))));
+    }
+
+    KCompletion completion;
+    completion.setSoundsEnabled(false);
+    completion.setCompletionMode(KCompletion::CompletionShell);
+    completion.setResultCacheSize(0);
+    completion.insertItems(items);
+
+    LatencyStats completionStats;
+    LatencyStats matchesStats;
+    QElapsedTimer timer;
+    QBENCHMARK {
+        for (const QString &lookup : std::as_const(lookups)) {
+            timer.start();
+            completion.makeCompletion(lookup);
+            completionStats.add(timer.nsecsElapsed());
+        }
+        for (const QString &query : queries) {
+            timer.start();
+            completion.allMatches(query);
+            matchesStats.add(timer.nsecsElapsed());
+        }
+    }
+    completionStats.report(reportName() + QLatin1String(" makeCompletion"));
+    matchesStats.report(reportName() + QLatin1String(" allMatches"));
+}
+
+void KCompletionBenchmark::removeItem_data()
+{
+    addCorpusRows();
+}
+
+void KCompletionBenchmark::removeItem()
+{
+    const QStringList &items = corpus();
+    QRandomGenerator random(quint32(items.count()));
+    QStringList churn;
+    for (int i = 0; i < s_queryCount; ++i) {
+        churn.append(items.at(random.bounded(int(items.count()))));
+    }
+
+    KCompletion completion;
+    completion.insertItems(items);
+
+    LatencyStats removeStats;
+    LatencyStats addStats;
+    QElapsedTimer timer;
+    QBENCHMARK {
+        for (const QString &item : std::as_const(churn)) {
+            timer.start();
+            completion.removeItem(item);
+            removeStats.add(timer.nsecsElapsed());
+
+            timer.start();
+            completion.addItem(item);
+            addStats.add(timer.nsecsElapsed());
+        }
+    }
+    removeStats.report(reportName());
+    addStats.report(reportName() + QLatin1String(" addItem"));
+}
+
+void KCompletionBenchmark::clear_data()
+{
+    addCorpusRows();
+}
+
+void KCompletionBenchmark::clear()
+{
+    const QStringList &items = corpus();
+
+    // only clear() is measured, not filling the completion again
+    constexpr int runs = 5;
+    LatencyStats stats;
+    QElapsedTimer timer;
+    KCompletion completion;
+    for (int i = 0; i < runs; ++i) {
+        completion.insertItems(items);
+        timer.start();
+        completion.clear();
+        stats.add(timer.nsecsElapsed());
+    }
+    QTest::setBenchmarkResult(stats.percentile(50) / 1000000.0, QTest::WalltimeMilliseconds);
+    stats.report(reportName());
+}
+
+void KCompletionBenchmark::memory_data()
+{
+    addCorpusRows();
+}
+
+void KCompletionBenchmark::memory()
+{
+    const QStringList &items = corpus();
+
+    const qint64 before = BenchmarkCorpus::currentMemoryKiB();
+    if (before < 0) {
+        QSKIP("The memory usage of the process is not known on this platform");
+    }
+    KCompletion completion;
+    completion.insertItems(items);
+    const qint64 after = BenchmarkCorpus::currentMemoryKiB();
+
+    QTest::setBenchmarkResult(qreal(after - before) * 1024, QTest::BytesAllocated);
+    qInfo().noquote() << reportName()
+                      << QStringLiteral("resident: +%1 KiB (%2 bytes per item) peak: %3 KiB")
+                             .arg(QString::number(after - before),
+                                  QString::number(qreal(after - before) * 1024 / items.count(), 'f', 1),
+                                  QString::number(BenchmarkCorpus::peakMemoryKiB()));
+}
+
+void KCompletionBenchmark::sortableListSort_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<bool>("sortItems");
+
+    for (int count : {1000, 100000}) {
+        QTest::addRow("%d items, KSortableList::sort()", count) << count << false;
+        QTest::addRow("%d items, std::stable_sort() on the items", count) << count << true;
+    }
+}
+
+void KCompletionBenchmark::sortableListSort()
+{
+    QFETCH(int, count);
+    QFETCH(bool, sortItems);
+
+    QRandomGenerator generator(42);
+    KSortableList<QString> list;
+    list.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        list.insert(generator.bounded(1000), QString::number(i));
+    }
+
+    QBENCHMARK {
+        KSortableList<QString> copy = list;
+        if (sortItems) {
+            std::stable_sort(copy.begin(), copy.end());
+        } else {
+            copy.sort();
+        }
+    }
+}
+
+QTEST_MAIN(KCompletionBenchmark)
+
+#include "kcompletionbenchmark.moc"
@@ -0,0 +1,356 @@
+/*
+    This file is part of the KDE libraries
+
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "benchmarkcorpus.h"
+
+#include <KCompletion>
+#include <KCompletionBox>
+#include <KHistoryComboBox>
+#include <KLineEdit>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTest>
+
+/*
+ * Replays typing sessions against a KLineEdit or KHistoryComboBox and measures
+ * the time from each key press until its events are processed.
+ *
+ * The time of every keystroke is broken down into
+ * \li engine: finding the completion and the matches
+ * \li view: filling the completion box with the matches
+ * \li layout: placing and showing the box, as well as the layouting and
+ *     painting done by the events posted for the keystroke
+ * \li other: the remainder, e.g. editing the text and rotating the matches
+ *
+ * The sessions are generated from the corpus, or read from the file given by
+ * the KCOMPLETION_BENCHMARK_SESSION environment variable. Such a recording has
+ * one keystroke per line, either the typed text or one of <Backspace>, <Tab>,
+ * <Backtab>, <Up>, <Down>, <Next>, <Prev>, <SelectAll>, <Return> and <Escape>.
+ *
+ * Runs on the offscreen platform unless QT_QPA_PLATFORM is set.
+ */
+class TypingLatencyBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    static void initMain()
+    {
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+    }
+
+private Q_SLOTS:
+    void lineEdit_data();
+    void lineEdit();
+    void historyComboBox_data();
+    void historyComboBox();
+};
+
+namespace
+{
+enum Phase {
+    Engine,
+    View,
+    Layout,
+    PhaseCount,
+};
+
+// The time spent in each phase during the current keystroke
+struct Breakdown {
+    qint64 nsecs[PhaseCount] = {};
+    QList<Phase> running;
+};
+
+Breakdown s_breakdown;
+
+// Measures a phase, excluding the nested ones
+class PhaseScope
+{
+public:
+    explicit PhaseScope(Phase phase)
+        : m_phase(phase)
+    {
+        s_breakdown.running.append(phase);
+        m_timer.start();
+    }
+
+    ~PhaseScope()
+    {
+        const qint64 elapsed = m_timer.nsecsElapsed();
+        s_breakdown.running.removeLast();
+        s_breakdown.nsecs[m_phase] += elapsed;
+        if (!s_breakdown.running.isEmpty()) {
+            s_breakdown.nsecs[s_breakdown.running.constLast()] -= elapsed;
+        }
+    }
+
+private:
+    const Phase m_phase;
+    QElapsedTimer m_timer;
+};
+
+class TimedCompletionBox : public KCompletionBox
+{
+public:
+    using KCompletionBox::KCompletionBox;
+
+    void popup() override
+    {
+        PhaseScope scope(Layout);
+        KCompletionBox::popup();
+    }
+};
+
+class TimedLineEdit : public KLineEdit
+{
+public:
+    explicit TimedLineEdit(QWidget *parent = nullptr)
+        : KLineEdit(parent)
+    {
+        setCompletionBox(new TimedCompletionBox(this));
+    }
+
+    void setCompletedItems(const QStringList &items, bool autoSuggest = true) override
+    {
+        PhaseScope scope(View);
+        KLineEdit::setCompletedItems(items, autoSuggest);
+    }
+
+    void makeCompletion(const QString &text) override
+    {
+        PhaseScope scope(Engine);
+        KLineEdit::makeCompletion(text);
+    }
+};
+
+struct Keystroke {
+    Qt::Key key = Qt::Key_unknown;
+    Qt::KeyboardModifiers modifiers;
+    QString text;
+};
+
+Keystroke parseKeystroke(const QString &token)
+{
+    static const QList<std::pair<QLatin1String, Keystroke>> specialKeys = {
+        {QLatin1String("<Backspace>"), {Qt::Key_Backspace, Qt::NoModifier, {}}},
+        {QLatin1String("<Tab>"), {Qt::Key_Tab, Qt::NoModifier, {}}},
+        {QLatin1String("<Backtab>"), {Qt::Key_Backtab, Qt::ShiftModifier, {}}},
+        {QLatin1String("<Up>"), {Qt::Key_Up, Qt::NoModifier, {}}},
+        {QLatin1String("<Down>"), {Qt::Key_Down, Qt::NoModifier, {}}},
+        // the default shortcuts for rotating the matches
+        {QLatin1String("<Next>"), {Qt::Key_Down, Qt::ControlModifier, {}}},
+        {QLatin1String("<Prev>"), {Qt::Key_Up, Qt::ControlModifier, {}}},
+        {QLatin1String("<SelectAll>"), {Qt::Key_A, Qt::ControlModifier, {}}},
+        {QLatin1String("<Return>"), {Qt::Key_Return, Qt::NoModifier, {}}},
+        {QLatin1String("<Escape>"), {Qt::Key_Escape, Qt::NoModifier, {}}},
+    };
+    for (const auto &[name, keystroke] : specialKeys) {
+        if (token == name) {
+            return keystroke;
+        }
+    }
+    Keystroke keystroke;
+    keystroke.text = token;
+    return keystroke;
+}
+
+// Types the beginning of random items, making and fixing typos, looking through the matches
+// and finally picking one or giving up on it
+QStringList generateSession(const QStringList &items, quint32 seed)
+{
+    constexpr int entries = 40;
+    QRandomGenerator random(seed);
+    QStringList session;
+    for (int entry = 0; entry < entries && !items.isEmpty(); ++entry) {
+        const QString &item = items.at(random.bounded(int(items.count())));
+        const int typed = std::min(int(item.length()), 2 + random.bounded(12));
+        for (int i = 0; i < typed; ++i) {
+            session.append(QString(item.at(i)));
+            if (random.bounded(10) == 0) {
+                session.append(QStringLiteral("x"));
+                session.append(QStringLiteral("<Backspace>"));
+            }
+        }
+
+        switch (random.bounded(4)) {
+        case 0:
+            session.append(QStringLiteral("<Tab>"));
+            session.append(QStringLiteral("<Tab>"));
+            session.append(QStringLiteral("<Backtab>"));
+            break;
+        case 1:
+            session.append(QStringLiteral("<Down>"));
+            session.append(QStringLiteral("<Down>"));
+            session.append(QStringLiteral("<Up>"));
+            break;
+        case 2:
+            session.append(QStringLiteral("<Next>"));
+            session.append(QStringLiteral("<Next>"));
+            session.append(QStringLiteral("<Prev>"));
+            break;
+        default:
+            session.append(QStringLiteral("<Escape>"));
+            break;
+        }
+        session.append(random.bounded(2) ? QStringLiteral("<Return>") : QStringLiteral("<Escape>"));
+        session.append(QStringLiteral("<SelectAll>"));
+        session.append(QStringLiteral("<Backspace>"));
+    }
+    return session;
+}
+
+QStringList session(const QStringList &items)
+{
+    const QString fileName = qEnvironmentVariable("KCOMPLETION_BENCHMARK_SESSION");
+    if (fileName.isEmpty()) {
+        return generateSession(items, 1);
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "Cannot read the session" << fileName;
+        return {};
+    }
+    QStringList session;
+    while (!file.atEnd()) {
+        QString line = QString::fromUtf8(file.readLine());
+        if (line.endsWith(QLatin1Char('\n'))) {
+            line.chop(1);
+        }
+        if (!line.isEmpty()) {
+            session.append(line);
+        }
+    }
+    return session;
+}
+
+void addRows()
+{
+    QTest::addColumn<int>("kind");
+    QTest::addColumn<int>("size");
+    QTest::addColumn<KCompletion::CompletionMode>("mode");
+
+    const QList<std::pair<const char *, KCompletion::CompletionMode>> modes = {
+        {"popup", KCompletion::CompletionPopup},
+        {"popupauto", KCompletion::CompletionPopupAuto},
+        {"shell", KCompletion::CompletionShell},
+    };
+    const QList<int> sizes = BenchmarkCorpus::sizes();
+    for (BenchmarkCorpus::Kind kind : BenchmarkCorpus::kinds()) {
+        for (int size : sizes) {
+            for (const auto &[name, mode] : modes) {
+                QTest::addRow("%s/%d/%s", BenchmarkCorpus::kindName(kind), size, name) << int(kind) << size << mode;
+            }
+        }
+    }
+}
+
+// Replays session against target, which has the focus
+void replay(QWidget *target, const QStringList &session)
+{
+    LatencyStats total;
+    LatencyStats phases[PhaseCount];
+    LatencyStats other;
+    QElapsedTimer timer;
+
+    for (const QString &token : session) {
+        const Keystroke keystroke = parseKeystroke(token);
+        s_breakdown = Breakdown();
+
+        timer.start();
+        if (keystroke.text.isEmpty()) {
+            QTest::keyClick(target, keystroke.key, keystroke.modifiers);
+        } else {
+            QTest::keyClicks(target, keystroke.text);
+        }
+        {
+            PhaseScope scope(Layout);
+            QCoreApplication::processEvents();
+        }
+        const qint64 elapsed = timer.nsecsElapsed();
+
+        total.add(elapsed);
+        qint64 measured = 0;
+        for (int phase = 0; phase < PhaseCount; ++phase) {
+            phases[phase].add(s_breakdown.nsecs[phase]);
+            measured += s_breakdown.nsecs[phase];
+        }
+        other.add(elapsed - measured);
+    }
+
+    const QString name = QLatin1String(QTest::currentTestFunction()) + QLatin1Char('(') + QLatin1String(QTest::currentDataTag()) + QLatin1Char(')');
+    total.report(name);
+    phases[Engine].report(name + QLatin1String(" engine"));
+    phases[View].report(name + QLatin1String(" view"));
+    phases[Layout].report(name + QLatin1String(" layout"));
+    other.report(name + QLatin1String(" other"));
+    QTest::setBenchmarkResult(total.percentile(50) / 1000000.0, QTest::WalltimeMilliseconds);
+}
+}
+
+void TypingLatencyBenchmark::lineEdit_data()
+{
+    addRows();
+}
+
+void TypingLatencyBenchmark::lineEdit()
+{
+    QFETCH(int, kind);
+    QFETCH(int, size);
+    QFETCH(KCompletion::CompletionMode, mode);
+    const QStringList items = BenchmarkCorpus::items(BenchmarkCorpus::Kind(kind), size);
+
+    TimedLineEdit lineEdit;
+    KCompletion completion;
+    completion.setSoundsEnabled(false);
+    completion.insertItems(items);
+    lineEdit.setCompletionObject(&completion);
+    lineEdit.setCompletionMode(mode);
+
+    lineEdit.show();
+    lineEdit.activateWindow();
+    QVERIFY(QTest::qWaitForWindowActive(&lineEdit));
+
+    replay(&lineEdit, session(items));
+}
+
+void TypingLatencyBenchmark::historyComboBox_data()
+{
+    addRows();
+}
+
+void TypingLatencyBenchmark::historyComboBox()
+{
+    QFETCH(int, kind);
+    QFETCH(int, size);
+    QFETCH(KCompletion::CompletionMode, mode);
+    const QStringList items = BenchmarkCorpus::items(BenchmarkCorpus::Kind(kind), size);
+
+    KHistoryComboBox comboBox;
+    comboBox.setLineEdit(new TimedLineEdit(&comboBox));
+    // the new line edit comes with a new completion object
+    comboBox.completionObject()->setOrder(KCompletion::Weighted);
+    comboBox.completionObject()->setSoundsEnabled(false);
+    comboBox.setMaxCount(size);
+    comboBox.setHistoryItems(items, true);
+    comboBox.setCompletionMode(mode);
+
+    comboBox.show();
+    comboBox.activateWindow();
+    QVERIFY(QTest::qWaitForWindowActive(&comboBox));
+
+    replay(comboBox.lineEdit(), session(items));
+}
+
+QTEST_MAIN(TypingLatencyBenchmark)
+
+#include "typinglatencybenchmark.moc"
@@ -164,6 +164,24 @@ bool KComboBox::trapReturnKey() const
     return d->trapReturnKey;
 }
 
+void KComboBox::setCompletionDelay(int msec)
+{
+    Q_D(KComboBox);
+    d->completionDelay = msec;
+
+    if (d->klineEdit) {
+        d->klineEdit->setCompletionDelay(msec);
+    } else {
+        qCWarning(KCOMPLETION_LOG) << "KComboBox::setCompletionDelay not supported with a non-KLineEdit.";
+    }
+}
+
+int KComboBox::completionDelay() const
+{
+    Q_D(const KComboBox);
+    return d->completionDelay;
+}
+
 void KComboBox::setEditUrl(const QUrl &url)
 {
     QComboBox::setEditText(url.toDisplayString());
@@ -294,6 +312,7 @@ void KComboBox::setLineEdit(QLineEdit *edit)
         connect(d->klineEdit, &KLineEdit::completionBoxActivated, this, &QComboBox::textActivated);
 
         d->klineEdit->setTrapReturnKey(d->trapReturnKey);
+        d->klineEdit->setCompletionDelay(d->completionDelay);
     }
 }
 
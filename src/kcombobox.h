@@ -290,6 +290,25 @@ public:
      */
     bool trapReturnKey() const;
 
+    /*!
+     * Sets the minimum interval between two completions in the popup completion
+     * modes to \a msec milliseconds.
+     *
+     * \note This only affects editable combo boxes.
+     *
+     * \since 6.30
+     * \sa KLineEdit::setCompletionDelay(), completionDelay()
+     */
+    void setCompletionDelay(int msec);
+
+    /*!
+     * Returns the minimum interval between two completions in milliseconds.
+     *
+     * \since 6.30
+     * \sa setCompletionDelay()
+     */
+    int completionDelay() const;
+
     /*!
      * This method will create a completion box by calling
      * KLineEdit::completionBox, if none is there yet.
@@ -40,6 +40,7 @@ public:
 
     KLineEdit *klineEdit = nullptr;
     bool trapReturnKey = false;
+    int completionDelay = 0;
     QPointer<QMenu> contextMenu;
     QMetaObject::Connection m_klineEditConnection;
 };
@@ -7,23 +7,27 @@
 
 #include "kcompletion.h"
 #include "kcompletion_p.h"
+#include "kcompletionparallel_p.h"
 #include <kcompletion_debug.h>
 
 #include <QCollator>
+#include <QGuiApplication>
+#include <QThreadPool>
+#include <QTimer>
 
-void KCompletionPrivate::addWeightedItem(const QString &item)
-{
-    Q_Q(KCompletion);
-    if (order != KCompletion::Weighted) {
-        q->addItem(item, 0);
-        return;
-    }
+#include <algorithm>
+#include <limits>
 
-    int len = item.length();
+namespace
+{
+// Returns the length of item without its weighting, and the weighting
+std::pair<qsizetype, uint> parseWeightedItem(const QString &item)
+{
+    qsizetype len = item.length();
     uint weight = 0;
 
     // find out the weighting of this item (appended to the string as ":num")
-    int index = item.lastIndexOf(QLatin1Char(':'));
+    qsizetype index = item.lastIndexOf(QLatin1Char(':'));
     if (index > 0) {
         bool ok;
         weight = QStringView(item).mid(index + 1).toUInt(&ok);
@@ -33,11 +37,343 @@ void KCompletionPrivate::addWeightedItem(const QString &item)
 
         len = index; // only insert until the ':'
     }
+    return {len, weight};
+}
+
+// Adds the characters of chars below node, confirming each of them
+// 1 + extraWeight times, and returns the node of the last one
+KCompTreeNode *insertChars(KCompTreeNode *node, QStringView chars, bool sorted, uint extraWeight)
+{
+    for (const QChar ch : chars) {
+        node = node->insert(ch, sorted);
+        if (extraWeight) {
+            node->confirm(extraWeight); // node->insert() sets weighting to 1
+        }
+    }
+    return node;
+}
+
+// Adds the 0x0 node terminating an item below node and returns it,
+// counting the item in itemCount unless it was inserted before
+KCompTreeNode *insertTerminator(KCompTreeNode *node, uint extraWeight, qsizetype &itemCount)
+{
+    const uint childrenCount = node->childrenCount();
+    // add 0x0-item as delimiter with evtl. weight
+    KCompTreeNode *terminator = node->insert(QChar(0x0), true);
+    if (extraWeight) {
+        terminator->confirm(extraWeight);
+    }
+    if (node->childrenCount() != childrenCount) {
+        ++itemCount;
+    }
+    return terminator;
+}
+
+// An item to insert, weight being 0 for the unweighted ones
+struct KCompletionInsertion {
+    QString item;
+    uint weight;
+};
+
+/*
+ * The items sharing the first few characters, which can be inserted below
+ * the node of these characters independently of the other items.
+ */
+struct KCompletionInsertPartition {
+    KCompTreeNode *node = nullptr;
+    // the positions of the items in the insertions, in insertion order
+    QList<qsizetype> insertions;
+    // the 0x0 node of each inserted item, for interning them afterwards
+    QList<const KCompTreeNode *> terminators;
+    // the number of items that weren't in the tree before
+    qsizetype itemCount = 0;
+};
+
+// A part of the matches of a scan: either the items below node, or the single
+// item ending with the 0x0 node
+struct KCompletionScanPart {
+    const KCompTreeNode *node;
+    QString beginning;
+    bool isItem;
+};
+
+// Replaces every subtree of parts by its items and the subtrees below it,
+// in the order of KCompletionMatchesWrapper::extractStringsFromNode()
+void splitScanParts(QList<KCompletionScanPart> &parts)
+{
+    QList<KCompletionScanPart> split;
+    for (const KCompletionScanPart &part : std::as_const(parts)) {
+        if (part.isItem) {
+            split.append(part);
+            continue;
+        }
+        for (const KCompTreeNode *cur = part.node->firstChild(); cur; cur = cur->m_next) {
+            const KCompTreeNode *node = cur;
+            QString string = part.beginning;
+            if (!node->isNull()) {
+                string += *node;
+            }
+            while (node->childrenCount() == 1) {
+                node = node->firstChild();
+                if (node->isNull()) {
+                    break;
+                }
+                string += *node;
+            }
+            split.append({node, string, node->isNull()});
+        }
+    }
+    parts = split;
+}
+
+// The block size of the allocators of the tree nodes
+constexpr unsigned long s_nodeBlockSize = 8 * 1024;
+
+// Builds the partitions into at most this many characters of the items
+constexpr qsizetype s_maxPartitionDepth = 8;
+
+// Chooses the number of leading characters the items are partitioned by:
+// the smallest one for which no partition holds much more than its share
+// of a sample of the items
+qsizetype partitionDepth(const QList<KCompletionInsertion> &insertions, int threadCount)
+{
+    constexpr qsizetype sampleSize = 10000;
+    const qsizetype step = std::max<qsizetype>(1, insertions.count() / sampleSize);
+    qsizetype depth = 1;
+    for (; depth < s_maxPartitionDepth; ++depth) {
+        QHash<QStringView, qsizetype> sizes;
+        qsizetype sampled = 0;
+        qsizetype largest = 0;
+        for (qsizetype i = 0; i < insertions.count(); i += step, ++sampled) {
+            const QString &item = insertions.at(i).item;
+            largest = std::max(largest, ++sizes[QStringView(item).left(depth)]);
+        }
+        if (largest * threadCount * 2 <= sampled) {
+            break;
+        }
+    }
+    return depth;
+}
+}
+
+void KCompletionPrivate::addWeightedItem(const QString &item)
+{
+    Q_Q(KCompletion);
+    if (order != KCompletion::Weighted) {
+        q->addItem(item, 0);
+        return;
+    }
 
+    const auto [len, weight] = parseWeightedItem(item);
     q->addItem(item.left(len), weight);
     return;
 }
 
+void KCompletionPrivate::internItem(const KCompTreeNode *terminator, const QString &item)
+{
+    QString &pooled = itemPool[terminator];
+    if (pooled.isNull()) {
+        pooled = item;
+    }
+}
+
+void KCompletionPrivate::insertItemsInParallel(const QStringList &items)
+{
+    QList<KCompletionInsertion> insertions;
+    insertions.reserve(items.count());
+    for (const QString &item : items) {
+        if (order == KCompletion::Weighted) {
+            const auto [len, weight] = parseWeightedItem(item);
+            if (len > 0) {
+                insertions.append({item.left(len), weight});
+            }
+        } else if (!item.isEmpty()) {
+            insertions.append({item, 0});
+        }
+    }
+    if (insertions.isEmpty()) {
+        return;
+    }
+
+    itemsChanged();
+    statistics.treeMutations += insertions.count();
+    const bool sorted = (order == KCompletion::Sorted);
+    const auto extraWeight = [this](uint weight) {
+        // see KCompletion::addItem()
+        return order == KCompletion::Weighted && weight > 1 ? weight - 1 : 0;
+    };
+
+    const qsizetype depth = partitionDepth(insertions, QThreadPool::globalInstance()->maxThreadCount());
+
+    // The first depth characters of every item are inserted here, in the
+    // order of the items, so that the nodes up to there are the same as
+    // with serial insertion. The items not longer than that are inserted
+    // here altogether. Below the nodes at depth, the items of each
+    // partition are inserted by one thread, in their order as well.
+    std::vector<KCompletionInsertPartition> partitions;
+    QHash<const KCompTreeNode *, qsizetype> partitionOfNode;
+    for (qsizetype i = 0; i < insertions.count(); ++i) {
+        const KCompletionInsertion &insertion = insertions.at(i);
+        const QStringView item(insertion.item);
+        KCompTreeNode *node = insertChars(m_treeRoot.get(), item.left(depth), sorted, extraWeight(insertion.weight));
+        if (item.length() < depth) {
+            node = insertTerminator(node, extraWeight(insertion.weight), itemCount);
+            if (internItems) {
+                internItem(node, insertion.item);
+            }
+            continue;
+        }
+
+        const auto it = partitionOfNode.constFind(node);
+        if (it != partitionOfNode.cend()) {
+            partitions[*it].insertions.append(i);
+        } else {
+            partitionOfNode.insert(node, qsizetype(partitions.size()));
+            KCompletionInsertPartition &partition = partitions.emplace_back();
+            partition.node = node;
+            partition.insertions.append(i);
+        }
+    }
+
+    if (partitions.empty()) {
+        return;
+    }
+
+    // the largest partitions first, so that they don't end up last on a thread
+    std::vector<KCompletionInsertPartition *> queue;
+    queue.reserve(partitions.size());
+    for (KCompletionInsertPartition &partition : partitions) {
+        queue.push_back(&partition);
+    }
+    std::stable_sort(queue.begin(), queue.end(), [](const KCompletionInsertPartition *a, const KCompletionInsertPartition *b) {
+        return a->insertions.count() > b->insertions.count();
+    });
+
+    // every thread allocates the nodes from its own allocator
+    std::vector<std::unique_ptr<KZoneAllocator>> allocators;
+    for (int i = 0; i < KCompletionParallel::threadCount(queue.size()); ++i) {
+        allocators.push_back(std::make_unique<KZoneAllocator>(s_nodeBlockSize));
+    }
+
+    KCompletionParallel::run(queue.size(), [&](qsizetype task, int thread) {
+        KCompletionInsertPartition &partition = *queue[task];
+        KCompTreeNode::setThreadAllocator(allocators[thread].get());
+        for (qsizetype index : std::as_const(partition.insertions)) {
+            const KCompletionInsertion &insertion = insertions.at(index);
+            const uint weight = extraWeight(insertion.weight);
+            KCompTreeNode *node = insertChars(partition.node, QStringView(insertion.item).mid(depth), sorted, weight);
+            node = insertTerminator(node, weight, partition.itemCount);
+            if (internItems) {
+                partition.terminators.append(node);
+            }
+        }
+        KCompTreeNode::setThreadAllocator(nullptr);
+    });
+
+    // the nodes are deleted through KCompTreeNode::allocator()
+    const QSharedPointer<KZoneAllocator> allocator = KCompTreeNode::allocator();
+    for (const auto &threadAllocator : allocators) {
+        allocator->takeBlocks(*threadAllocator);
+    }
+    for (const KCompletionInsertPartition &partition : partitions) {
+        itemCount += partition.itemCount;
+        for (qsizetype i = 0; i < partition.terminators.count(); ++i) {
+            internItem(partition.terminators.at(i), insertions.at(partition.insertions.at(i)).item);
+        }
+    }
+}
+
+void KCompletionPrivate::extractMatches(KCompletionMatchesWrapper &matches,
+                                        const QList<KCompTreeSubtree> &subtrees,
+                                        const std::function<bool(const QString &)> &filter) const
+{
+    if (!runsInParallel(itemCount)) {
+        for (const KCompTreeSubtree &subtree : subtrees) {
+            matches.extractStringsFromNode(subtree.node, subtree.beginning, false);
+        }
+        if (filter) {
+            matches.filter(filter);
+        }
+        return;
+    }
+
+    // Split the subtrees until there are enough of them to keep all threads
+    // busy, the items found on the way are added in between
+    QList<KCompletionScanPart> parts;
+    for (const KCompTreeSubtree &subtree : subtrees) {
+        parts.append({subtree.node, subtree.beginning, false});
+    }
+    const qsizetype enoughParts = 4 * QThreadPool::globalInstance()->maxThreadCount();
+    QList<qsizetype> subtreeParts;
+    for (int depth = 0;; ++depth) {
+        subtreeParts.clear();
+        for (qsizetype i = 0; i < parts.count(); ++i) {
+            if (!parts.at(i).isItem) {
+                subtreeParts.append(i);
+            }
+        }
+        if (subtreeParts.isEmpty() || subtreeParts.count() >= enoughParts || depth == s_maxPartitionDepth) {
+            break;
+        }
+        splitScanParts(parts);
+    }
+
+    std::vector<std::unique_ptr<KCompletionMatchesWrapper>> results(parts.count());
+    KCompletionParallel::run(subtreeParts.count(), [&](qsizetype task, int) {
+        const qsizetype index = subtreeParts.at(task);
+        const KCompletionScanPart &part = parts.at(index);
+        auto result = std::make_unique<KCompletionMatchesWrapper>(sorterFunction, matches.sorting());
+        result->setItemPool(itemPoolOrNull());
+        result->extractStringsFromNode(part.node, part.beginning, false);
+        if (filter) {
+            result->filter(filter);
+        }
+        results[index] = std::move(result);
+    });
+
+    for (qsizetype i = 0; i < parts.count(); ++i) {
+        const KCompletionScanPart &part = parts.at(i);
+        if (!part.isItem) {
+            matches.appendMatches(*results[i]);
+            continue;
+        }
+        const QString item = internItems ? itemPool.value(part.node) : part.beginning;
+        if (!filter || filter(item)) {
+            matches.append(part.node->weight(), item);
+        }
+    }
+}
+
+void KCompletionPrivate::findMatches(KCompletionMatchesWrapper &matches, const QString &string, bool &hasMultipleMatches) const
+{
+    ++statistics.matchSearches;
+    if (!ignoreCase || string.isEmpty() || !runsInParallel(itemCount)) {
+        matches.findAllCompletions(m_treeRoot.get(), string, ignoreCase, hasMultipleMatches);
+        return;
+    }
+
+    // case insensitive completion
+    QList<KCompTreeSubtree> subtrees;
+    KCompletionMatchesWrapper::findSubtreesCI(m_treeRoot.get(), QString(), string, subtrees);
+    extractMatches(matches, subtrees);
+    hasMultipleMatches = (matches.size() > 1);
+}
+
+void KCompletionPrivate::findLastMatches(const QString &string, bool sort)
+{
+    findAllCompletions(matches, string, sort, hasMultipleMatches);
+    lastMatchesQuery = KCompletionCacheKey{string, ignoreCase, order};
+    lastMatchesGeneration = generation;
+}
+
+KCompletionMatchesWrapper *KCompletionPrivate::lastMatchesOf(const QString &string)
+{
+    if (!lastMatchesQuery || lastMatchesGeneration != generation || !(*lastMatchesQuery == KCompletionCacheKey{string, ignoreCase, order})) {
+        return nullptr;
+    }
+    return &matches;
+}
+
 // tries to complete "string" from the tree-root
 QString KCompletionPrivate::findCompletion(const QString &string)
 {
@@ -45,12 +381,15 @@ QString KCompletionPrivate::findCompletion(const QString &string)
     const KCompTreeNode *node = m_treeRoot.get();
 
     // start at the tree-root and try to find the search-string
+    qsizetype visited = 0;
     for (const auto ch : string) {
         node = node->find(ch);
 
         if (node) {
             completion += ch;
+            ++visited;
         } else {
+            KCompletionTrace::addVisited(visited);
             return QString(); // no completion
         }
     }
@@ -61,6 +400,7 @@ QString KCompletionPrivate::findCompletion(const QString &string)
 
     while (node->childrenCount() == 1) {
         node = node->firstChild();
+        ++visited;
         if (!node->isNull()) {
             completion += *node;
         }
@@ -74,6 +414,7 @@ QString KCompletionPrivate::findCompletion(const QString &string)
             rotationIndex = 1;
             if (order != KCompletion::Weighted) {
                 while ((node = node->firstChild())) {
+                    ++visited;
                     if (!node->isNull()) {
                         completion += *node;
                     } else {
@@ -87,6 +428,7 @@ QString KCompletionPrivate::findCompletion(const QString &string)
                 const KCompTreeNode *temp_node = nullptr;
                 while (1) {
                     int count = node->childrenCount();
+                    visited += count;
                     temp_node = node->firstChild();
                     uint weight = temp_node->weight();
                     const KCompTreeNode *hit = temp_node;
@@ -109,9 +451,180 @@ QString KCompletionPrivate::findCompletion(const QString &string)
         }
     }
 
+    KCompletionTrace::addVisited(visited);
     return completion;
 }
 
+const KCompTreeNode *KCompletionPrivate::findItemNode(const QString &item) const
+{
+    const KCompTreeNode *node = m_treeRoot.get();
+    for (const auto ch : item) {
+        node = node->find(ch);
+        if (!node) {
+            return nullptr;
+        }
+    }
+    return node->find(QChar(0x0));
+}
+
+void KCompletionPrivate::fillItemPool(const KCompTreeNode *node, QString &prefix)
+{
+    for (const KCompTreeNode *cur = node->firstChild(); cur; cur = cur->m_next) {
+        if (cur->isNull()) {
+            // don't share prefix, it is modified further on
+            itemPool.insert(cur, QString(prefix.constData(), prefix.size()));
+        } else {
+            prefix += *cur;
+            fillItemPool(cur, prefix);
+            prefix.chop(1);
+        }
+    }
+}
+
+void KCompletionPrivate::findAllCompletions(KCompletionMatchesWrapper &matches, const QString &string, bool sort, bool &hasMultipleMatches)
+{
+    if (resultCache.maxCost() <= 0) {
+        matches.setItemPool(itemPoolOrNull());
+        findMatches(matches, string, hasMultipleMatches);
+        return;
+    }
+
+    const KCompletionCacheKey key{string, ignoreCase, order};
+    KCompletionCachedMatches *cached = resultCache.object(key);
+    if (cached && cached->generation == generation) {
+        ++statistics.resultCacheHits;
+        KCompletionTrace::setCached();
+    } else {
+        ++statistics.resultCacheMisses;
+        cached = new KCompletionCachedMatches(sorterFunction, order, generation);
+        cached->matches.setItemPool(itemPoolOrNull());
+        findMatches(cached->matches, string, cached->hasMultipleMatches);
+        resultCache.insert(key, cached);
+    }
+
+    if (sort) {
+        cached->matches.list();
+    }
+    matches.assign(cached->matches);
+    if (cached->hasMultipleMatches) {
+        hasMultipleMatches = true;
+    }
+}
+
+std::unique_ptr<KCompTreeItemWalker> KCompletionPrivate::walkMatches(const QString &string) const
+{
+    if (string.isEmpty()) {
+        return nullptr;
+    }
+
+    const KCompTreeNode *node = m_treeRoot.get();
+    for (const QChar ch : string) {
+        node = node->find(ch);
+        if (!node) {
+            return nullptr;
+        }
+    }
+    return std::make_unique<KCompTreeItemWalker>(node, string, itemPoolOrNull());
+}
+
+QStringList KCompletionPrivate::walkNextMatches(qsizetype count)
+{
+    KCompletionMatchesWrapper found(sorterFunction);
+    matchWalker->next(found, count);
+    if (matchWalker->atEnd()) {
+        matchWalker.reset();
+    }
+    return found.list();
+}
+
+void KCompletionPrivate::cancelMatchStream()
+{
+    ++streamId;
+    streamedMatches.reset();
+    matchWalker.reset();
+    streamedList.clear();
+    streamedCount = 0;
+}
+
+QStringList KCompletionPrivate::takeMatchChunk()
+{
+    if (matchWalker) {
+        return walkNextMatches(matchChunkSize > 0 ? matchChunkSize : std::numeric_limits<qsizetype>::max());
+    }
+
+    if (streamedMatches) {
+        streamedList = streamedMatches->list();
+        streamedMatches.reset();
+    }
+
+    const QStringList chunk = streamedList.mid(streamedCount, matchChunkSize > 0 ? matchChunkSize : -1);
+    streamedCount += chunk.size();
+    if (streamedCount >= streamedList.size()) {
+        streamedList.clear();
+        streamedCount = 0;
+    }
+    return chunk;
+}
+
+void KCompletionPrivate::scheduleMatchChunk()
+{
+    QTimer::singleShot(0, q_ptr, [this, id = streamId]() {
+        Q_Q(KCompletion);
+        if (id != streamId || !q->hasMoreMatches()) {
+            return;
+        }
+        q->fetchMoreMatches();
+        if (q->hasMoreMatches()) {
+            scheduleMatchChunk();
+        }
+    });
+}
+
+void KCompletionPrivate::scheduleRequest()
+{
+    if (requestScheduled || requests.isEmpty()) {
+        return;
+    }
+    requestScheduled = true;
+    QTimer::singleShot(0, q_ptr, [this]() {
+        requestScheduled = false;
+        handleNextRequest();
+    });
+}
+
+// Returns true if focus is requester or one of its children
+static bool hasFocus(const QObject *requester, const QObject *focus)
+{
+    for (; focus; focus = focus->parent()) {
+        if (focus == requester) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void KCompletionPrivate::handleNextRequest()
+{
+    Q_Q(KCompletion);
+    requests.removeIf([](const KCompletionRequest &request) {
+        return !request.requester;
+    });
+    if (requests.isEmpty()) {
+        return;
+    }
+
+    // the request of the focused widget first, the others in order
+    const QObject *focus = qGuiApp ? qGuiApp->focusObject() : nullptr;
+    const auto it = std::find_if(requests.cbegin(), requests.cend(), [focus](const KCompletionRequest &request) {
+        return hasFocus(request.requester, focus);
+    });
+    const KCompletionRequest request = requests.takeAt(it != requests.cend() ? it - requests.cbegin() : 0);
+    scheduleRequest();
+
+    // the requester completes the string itself, so that it is searched only once
+    Q_EMIT q->completionReady(request.requester, request.string);
+}
+
 void KCompletionPrivate::defaultSort(QStringList &stringList)
 {
     QCollator c;
@@ -134,6 +647,7 @@ void KCompletion::setOrder(CompOrder order)
     Q_D(KCompletion);
     d->order = order;
     d->matches.setSorting(order);
+    d->itemsChanged();
 }
 
 KCompletion::CompOrder KCompletion::order() const
@@ -163,6 +677,11 @@ void KCompletion::setItems(const QStringList &itemList)
 void KCompletion::insertItems(const QStringList &items)
 {
     Q_D(KCompletion);
+    if (d->runsInParallel(items.count())) {
+        d->insertItemsInParallel(items);
+        return;
+    }
+
     for (const auto &str : items) {
         if (d->order == Weighted) {
             d->addWeightedItem(str);
@@ -172,10 +691,34 @@ void KCompletion::insertItems(const QStringList &items)
     }
 }
 
+void KCompletion::setItemInterning(bool enable)
+{
+    Q_D(KCompletion);
+    if (d->internItems == enable) {
+        return;
+    }
+
+    d->internItems = enable;
+    d->matchWalker.reset();
+    d->itemPool.clear();
+    if (enable) {
+        QString prefix;
+        d->fillItemPool(d->m_treeRoot.get(), prefix);
+    }
+    d->matches.setItemPool(d->itemPoolOrNull());
+}
+
+bool KCompletion::itemInterning() const
+{
+    Q_D(const KCompletion);
+    return d->internItems;
+}
+
 QStringList KCompletion::items() const
 {
     Q_D(const KCompletion);
     KCompletionMatchesWrapper list(d->sorterFunction); // unsorted
+    list.setItemPool(d->itemPoolOrNull());
     list.extractStringsFromNode(d->m_treeRoot.get(), QString(), d->order == Weighted);
     return list.list();
 }
@@ -215,26 +758,19 @@ void KCompletion::addItem(const QString &item, uint weight)
         return;
     }
 
-    KCompTreeNode *node = d->m_treeRoot.get();
-    int len = item.length();
-
+    d->itemsChanged();
+    ++d->statistics.treeMutations;
     bool sorted = (d->order == Sorted);
     bool weighted = ((d->order == Weighted) && weight > 1);
 
     // knowing the weight of an item, we simply add this weight to all of its
     // nodes.
+    const uint extraWeight = weighted ? weight - 1 : 0;
+    KCompTreeNode *node = insertChars(d->m_treeRoot.get(), item, sorted, extraWeight);
+    node = insertTerminator(node, extraWeight, d->itemCount);
 
-    for (int i = 0; i < len; i++) {
-        node = node->insert(item.at(i), sorted);
-        if (weighted) {
-            node->confirm(weight - 1); // node->insert() sets weighting to 1
-        }
-    }
-
-    // add 0x0-item as delimiter with evtl. weight
-    node = node->insert(QChar(0x0), true);
-    if (weighted) {
-        node->confirm(weight - 1);
+    if (d->internItems) {
+        d->internItem(node, item);
     }
     //     qDebug("*** added: %s (%i)", item.toLatin1().constData(), node->weight());
 }
@@ -246,16 +782,29 @@ void KCompletion::removeItem(const QString &item)
     d->rotationIndex = 0;
     d->lastString.clear();
 
+    d->itemsChanged();
+    ++d->statistics.treeMutations;
+    if (const KCompTreeNode *node = d->findItemNode(item)) {
+        --d->itemCount;
+        if (d->internItems) {
+            d->itemPool.remove(node);
+        }
+    }
     d->m_treeRoot->remove(item);
 }
 
 void KCompletion::clear()
 {
     Q_D(KCompletion);
+    d->cancelMatchStream();
     d->matches.clear();
     d->rotationIndex = 0;
     d->lastString.clear();
 
+    d->itemsChanged();
+    ++d->statistics.treeMutations;
+    d->itemPool.clear();
+    d->itemCount = 0;
     d->m_treeRoot.reset(new KCompTreeNode);
 }
 
@@ -267,8 +816,11 @@ QString KCompletion::makeCompletion(const QString &string)
     }
 
     // qDebug() << "KCompletion: completing: " << string;
+    KCompletionQuery query(d, "makeCompletion", string, d->completionMode);
 
+    d->cancelMatchStream();
     d->matches.clear();
+    d->lastMatchesQuery.reset();
     d->rotationIndex = 0;
     d->hasMultipleMatches = false;
     d->lastMatch = d->currentMatch;
@@ -280,9 +832,14 @@ QString KCompletion::makeCompletion(const QString &string)
         // on d->matches here would interfere with call to
         // postProcessMatch() during rotation
 
-        d->matches.findAllCompletions(d->m_treeRoot.get(), string, d->ignoreCase, d->hasMultipleMatches);
+        d->findLastMatches(string, true);
         QStringList l = d->matches.list();
-        postProcessMatches(&l);
+        query.setResultCount(l.size());
+        {
+            KCompletionTrace::PhaseTimer postProcessing(KCompletionTrace::PostProcessing);
+            postProcessMatches(&l);
+        }
+        KCompletionTrace::PhaseTimer delivery(KCompletionTrace::Delivery);
         Q_EMIT matches(l);
 
         return QString();
@@ -290,8 +847,16 @@ QString KCompletion::makeCompletion(const QString &string)
 
     QString completion;
     // in case-insensitive popup mode, we search all completions at once
-    if (d->completionMode == CompletionPopup || d->completionMode == CompletionPopupAuto) {
-        d->matches.findAllCompletions(d->m_treeRoot.get(), string, d->ignoreCase, d->hasMultipleMatches);
+    if ((d->completionMode == CompletionPopup || d->completionMode == CompletionPopupAuto) && d->fetchMatchesOnDemand && d->canWalkMatches()) {
+        // the popup fetches the matches on demand, the first two tell all we need here
+        if (const auto walker = d->walkMatches(string)) {
+            KCompletionMatchesWrapper found(d->sorterFunction);
+            walker->next(found, 2);
+            completion = found.first();
+            d->hasMultipleMatches = found.size() > 1;
+        }
+    } else if (d->completionMode == CompletionPopup || d->completionMode == CompletionPopupAuto) {
+        d->findLastMatches(string, false);
         if (!d->matches.isEmpty()) {
             completion = d->matches.first();
         }
@@ -299,17 +864,23 @@ QString KCompletion::makeCompletion(const QString &string)
         completion = d->findCompletion(string);
     }
 
+    query.setResultCount(completion.isEmpty() ? 0 : 1);
     if (d->hasMultipleMatches) {
+        KCompletionTrace::PhaseTimer delivery(KCompletionTrace::Delivery);
         Q_EMIT multipleMatches();
     }
 
     d->lastString = string;
     d->currentMatch = completion;
 
-    postProcessMatch(&completion);
+    {
+        KCompletionTrace::PhaseTimer postProcessing(KCompletionTrace::PostProcessing);
+        postProcessMatch(&completion);
+    }
 
     if (!string.isEmpty()) { // only emit match when string is not empty
         // qDebug() << "KCompletion: Match: " << completion;
+        KCompletionTrace::PhaseTimer delivery(KCompletionTrace::Delivery);
         Q_EMIT match(completion);
     }
 
@@ -319,9 +890,18 @@ QString KCompletion::makeCompletion(const QString &string)
 QStringList KCompletion::substringCompletion(const QString &string) const
 {
     Q_D(const KCompletion);
-    // get all items in the tree, eventually in sorted order
+    KCompletionQuery query(d, "substringCompletion", string);
+    std::function<bool(const QString &)> filter;
+    if (!string.isEmpty()) { // If it's empty, nothing to compare
+        filter = [&string](const QString &item) {
+            return item.contains(string, Qt::CaseInsensitive); // always case insensitive
+        };
+    }
+
+    // get all items in the tree containing string, eventually in sorted order
     KCompletionMatchesWrapper allItems(d->sorterFunction, d->order);
-    allItems.extractStringsFromNode(d->m_treeRoot.get(), QString(), false);
+    allItems.setItemPool(d->itemPoolOrNull());
+    d->extractMatches(allItems, {{d->m_treeRoot.get(), QString()}}, filter);
 
     QStringList list = allItems.list();
 
@@ -330,13 +910,8 @@ QStringList KCompletion::substringCompletion(const QString &string) const
         return list;
     }
 
-    if (!string.isEmpty()) { // If it's empty, nothing to compare
-        auto it = std::remove_if(list.begin(), list.end(), [&string](const QString &item) {
-            return !item.contains(string, Qt::CaseInsensitive); // always case insensitive
-        });
-        list.erase(it, list.end());
-    }
-
+    query.setResultCount(list.size());
+    KCompletionTrace::PhaseTimer postProcessing(KCompletionTrace::PostProcessing);
     postProcessMatches(&list);
     return list;
 }
@@ -369,6 +944,7 @@ void KCompletion::setSorterFunction(SorterFunction sortFunc)
 {
     Q_D(KCompletion);
     d->sorterFunction = sortFunc ? sortFunc : KCompletionPrivate::defaultSort;
+    d->itemsChanged();
 }
 
 QStringList KCompletion::allMatches()
@@ -377,10 +953,20 @@ QStringList KCompletion::allMatches()
     // Don't use d->matches since calling postProcessMatches()
     // on d->matches here would interfere with call to
     // postProcessMatch() during rotation
-    KCompletionMatchesWrapper matches(d->sorterFunction, d->order);
-    bool dummy;
-    matches.findAllCompletions(d->m_treeRoot.get(), d->lastString, d->ignoreCase, dummy);
-    QStringList l = matches.list();
+    KCompletionQuery query(d, "allMatches", d->lastString);
+    QStringList l;
+    if (KCompletionMatchesWrapper *lastMatches = d->lastMatchesOf(d->lastString)) {
+        // the popup shows the matches makeCompletion() just found
+        KCompletionTrace::setCached();
+        l = lastMatches->list();
+    } else {
+        KCompletionMatchesWrapper matches(d->sorterFunction, d->order);
+        bool dummy;
+        d->findAllCompletions(matches, d->lastString, true, dummy);
+        l = matches.list();
+    }
+    query.setResultCount(l.size());
+    KCompletionTrace::PhaseTimer postProcessing(KCompletionTrace::PostProcessing);
     postProcessMatches(&l);
     return l;
 }
@@ -391,10 +977,12 @@ KCompletionMatches KCompletion::allWeightedMatches()
     // Don't use d->matches since calling postProcessMatches()
     // on d->matches here would interfere with call to
     // postProcessMatch() during rotation
+    KCompletionQuery query(d, "allWeightedMatches", d->lastString);
     KCompletionMatchesWrapper matches(d->sorterFunction, d->order);
     bool dummy;
-    matches.findAllCompletions(d->m_treeRoot.get(), d->lastString, d->ignoreCase, dummy);
+    d->findAllCompletions(matches, d->lastString, d->order != Weighted, dummy);
     KCompletionMatches ret(matches);
+    query.setResultCount(ret.size());
     postProcessMatches(&ret);
     return ret;
 }
@@ -402,21 +990,296 @@ KCompletionMatches KCompletion::allWeightedMatches()
 QStringList KCompletion::allMatches(const QString &string)
 {
     Q_D(KCompletion);
+    KCompletionQuery query(d, "allMatches", string);
     KCompletionMatchesWrapper matches(d->sorterFunction, d->order);
     bool dummy;
-    matches.findAllCompletions(d->m_treeRoot.get(), string, d->ignoreCase, dummy);
+    d->findAllCompletions(matches, string, true, dummy);
     QStringList l = matches.list();
+    query.setResultCount(l.size());
+    KCompletionTrace::PhaseTimer postProcessing(KCompletionTrace::PostProcessing);
+    postProcessMatches(&l);
+    return l;
+}
+
+QStringList KCompletion::allMatches(const QString &string, int limit)
+{
+    Q_D(KCompletion);
+    if (limit < 0) {
+        return allMatches(string);
+    }
+
+    KCompletionQuery query(d, "allMatches", string);
+    QStringList l;
+    if (d->canWalkMatches()) {
+        // no need to visit more items than requested
+        if (const auto walker = d->walkMatches(string)) {
+            KCompletionMatchesWrapper found(d->sorterFunction);
+            walker->next(found, limit);
+            l = found.list();
+        }
+    } else {
+        KCompletionMatchesWrapper matches(d->sorterFunction, d->order);
+        bool dummy;
+        d->findAllCompletions(matches, string, false, dummy);
+        l = matches.list(limit);
+    }
+    query.setResultCount(l.size());
+    KCompletionTrace::PhaseTimer postProcessing(KCompletionTrace::PostProcessing);
     postProcessMatches(&l);
     return l;
 }
 
+QStringList KCompletion::streamMatches(const QString &string)
+{
+    Q_D(KCompletion);
+    d->cancelMatchStream();
+    KCompletionQuery query(d, "streamMatches", string);
+    if (d->matchChunkSize <= 0) {
+        const QStringList l = allMatches(string);
+        query.setResultCount(l.size());
+        return l;
+    }
+
+    if (d->fetchMatchesOnDemand && d->canWalkMatches()) {
+        QStringList chunk;
+        d->matchWalker = d->walkMatches(string);
+        if (d->matchWalker) {
+            chunk = d->walkNextMatches(d->matchChunkSize);
+        }
+        query.setResultCount(chunk.size());
+        postProcessMatches(&chunk);
+        return chunk;
+    }
+
+    auto matches = std::make_unique<KCompletionMatchesWrapper>(d->sorterFunction, d->order);
+    if (const KCompletionMatchesWrapper *lastMatches = d->lastMatchesOf(string)) {
+        // e.g. KLineEdit streams the matches of the makeCompletion() call it just made
+        KCompletionTrace::setCached();
+        matches->assign(*lastMatches);
+    } else {
+        bool dummy;
+        d->findAllCompletions(*matches, string, false, dummy);
+    }
+
+    QStringList chunk = matches->list(d->matchChunkSize);
+    if (qsizetype(matches->size()) > chunk.size()) {
+        d->streamedMatches = std::move(matches);
+        d->streamedCount = chunk.size();
+        if (!d->fetchMatchesOnDemand) {
+            d->scheduleMatchChunk();
+        }
+    }
+    query.setResultCount(chunk.size());
+    postProcessMatches(&chunk);
+    return chunk;
+}
+
+bool KCompletion::hasMoreMatches() const
+{
+    Q_D(const KCompletion);
+    return d->streamedMatches || d->matchWalker || !d->streamedList.isEmpty();
+}
+
+void KCompletion::requestCompletion(QObject *requester, const QString &string)
+{
+    Q_D(KCompletion);
+    for (KCompletionRequest &request : d->requests) {
+        if (request.requester == requester) {
+            request.string = string;
+            return;
+        }
+    }
+    d->requests.append({requester, string});
+    d->scheduleRequest();
+}
+
+void KCompletion::cancelCompletionRequest(QObject *requester)
+{
+    Q_D(KCompletion);
+    d->requests.removeIf([requester](const KCompletionRequest &request) {
+        return request.requester == requester;
+    });
+}
+
+bool KCompletion::hasCompletionRequest(QObject *requester) const
+{
+    Q_D(const KCompletion);
+    return std::any_of(d->requests.cbegin(), d->requests.cend(), [requester](const KCompletionRequest &request) {
+        return request.requester == requester;
+    });
+}
+
+KCompletion::Statistics KCompletion::statistics() const
+{
+    Q_D(const KCompletion);
+    auto *statistics = new KCompletionStatisticsPrivate;
+    statistics->counters = d->statistics;
+    return Statistics(statistics);
+}
+
+void KCompletion::resetStatistics()
+{
+    Q_D(KCompletion);
+    d->statistics = KCompletionStatisticsCounters();
+}
+
+KCompletion::Statistics::Statistics()
+    : d(new KCompletionStatisticsPrivate)
+{
+}
+
+KCompletion::Statistics::Statistics(KCompletionStatisticsPrivate *dd)
+    : d(dd)
+{
+}
+
+KCompletion::Statistics::Statistics(const Statistics &other) = default;
+
+KCompletion::Statistics &KCompletion::Statistics::operator=(const Statistics &other) = default;
+
+KCompletion::Statistics::~Statistics() = default;
+
+quint64 KCompletion::Statistics::completions(CompletionMode mode) const
+{
+    return d->counters.completions.value(mode);
+}
+
+quint64 KCompletion::Statistics::matchQueries() const
+{
+    return d->counters.matchQueries;
+}
+
+quint64 KCompletion::Statistics::resultCacheHits() const
+{
+    return d->counters.resultCacheHits;
+}
+
+quint64 KCompletion::Statistics::resultCacheMisses() const
+{
+    return d->counters.resultCacheMisses;
+}
+
+quint64 KCompletion::Statistics::matchSearches() const
+{
+    return d->counters.matchSearches;
+}
+
+quint64 KCompletion::Statistics::totalMatches() const
+{
+    return d->counters.totalMatches;
+}
+
+quint64 KCompletion::Statistics::maxMatches() const
+{
+    return d->counters.maxMatches;
+}
+
+std::chrono::nanoseconds KCompletion::Statistics::totalTime() const
+{
+    return d->counters.totalTime;
+}
+
+quint64 KCompletion::Statistics::treeMutations() const
+{
+    return d->counters.treeMutations;
+}
+
+quint64 KCompletion::Statistics::queries() const
+{
+    quint64 count = d->counters.matchQueries;
+    for (const quint64 modeCount : std::as_const(d->counters.completions)) {
+        count += modeCount;
+    }
+    return count;
+}
+
+double KCompletion::Statistics::averageMatches() const
+{
+    const quint64 count = queries();
+    return count ? double(d->counters.totalMatches) / count : 0.0;
+}
+
+void KCompletion::fetchMoreMatches()
+{
+    Q_D(KCompletion);
+    if (!hasMoreMatches()) {
+        return;
+    }
+
+    QStringList chunk = d->takeMatchChunk();
+    postProcessMatches(&chunk);
+    Q_EMIT moreMatches(chunk);
+}
+
+void KCompletion::setMatchChunkSize(int size)
+{
+    Q_D(KCompletion);
+    d->matchChunkSize = qMax(size, 0);
+}
+
+int KCompletion::matchChunkSize() const
+{
+    Q_D(const KCompletion);
+    return d->matchChunkSize;
+}
+
+void KCompletion::setFetchMatchesOnDemand(bool onDemand)
+{
+    Q_D(KCompletion);
+    d->fetchMatchesOnDemand = onDemand;
+}
+
+bool KCompletion::fetchMatchesOnDemand() const
+{
+    Q_D(const KCompletion);
+    return d->fetchMatchesOnDemand;
+}
+
+void KCompletion::setResultCacheSize(int size)
+{
+    Q_D(KCompletion);
+    d->resultCache.setMaxCost(qMax(size, 0));
+}
+
+int KCompletion::resultCacheSize() const
+{
+    Q_D(const KCompletion);
+    return int(d->resultCache.maxCost());
+}
+
+quint64 KCompletion::resultCacheHits() const
+{
+    Q_D(const KCompletion);
+    return d->statistics.resultCacheHits;
+}
+
+quint64 KCompletion::resultCacheMisses() const
+{
+    Q_D(const KCompletion);
+    return d->statistics.resultCacheMisses;
+}
+
+void KCompletion::setParallelThreshold(int itemCount)
+{
+    Q_D(KCompletion);
+    d->parallelThreshold = qMax(itemCount, 0);
+}
+
+int KCompletion::parallelThreshold() const
+{
+    Q_D(const KCompletion);
+    return d->parallelThreshold;
+}
+
 KCompletionMatches KCompletion::allWeightedMatches(const QString &string)
 {
     Q_D(KCompletion);
+    KCompletionQuery query(d, "allWeightedMatches", string);
     KCompletionMatchesWrapper matches(d->sorterFunction, d->order);
     bool dummy;
-    matches.findAllCompletions(d->m_treeRoot.get(), string, d->ignoreCase, dummy);
+    d->findAllCompletions(matches, string, d->order != Weighted, dummy);
     KCompletionMatches ret(matches);
+    query.setResultCount(ret.size());
     postProcessMatches(&ret);
     return ret;
 }
@@ -453,7 +1316,7 @@ QString KCompletion::nextMatch()
     d->lastMatch = d->currentMatch;
 
     if (d->matches.isEmpty()) {
-        d->matches.findAllCompletions(d->m_treeRoot.get(), d->lastString, d->ignoreCase, d->hasMultipleMatches);
+        d->findLastMatches(d->lastString, false);
         if (!d->matches.isEmpty()) {
             completion = d->matches.first();
         }
@@ -491,7 +1354,7 @@ QString KCompletion::previousMatch()
     d->lastMatch = d->currentMatch;
 
     if (d->matches.isEmpty()) {
-        d->matches.findAllCompletions(d->m_treeRoot.get(), d->lastString, d->ignoreCase, d->hasMultipleMatches);
+        d->findLastMatches(d->lastString, true);
         if (!d->matches.isEmpty()) {
             completion = d->matches.last();
         }
@@ -518,6 +1381,19 @@ QString KCompletion::previousMatch()
     return completion;
 }
 
-QSharedPointer<KZoneAllocator> KCompTreeNode::m_alloc(new KZoneAllocator(8 * 1024));
+void KCompletionTrace::log() const
+{
+    const auto msecs = [](qint64 nsecs) {
+        return QString::number(nsecs / 1000000.0, 'f', 3);
+    };
+    qCDebug(KCOMPLETION_TRACE_LOG).nospace().noquote() << m_operation << " " << m_completion << ": prefix length " << m_prefixLength << ", "
+                                                      << m_visitedNodes << " nodes visited, " << m_extractedMatches << " matches extracted"
+                                                      << (m_cached ? " (cached)" : "") << ", " << m_resultCount << " returned, sorting "
+                                                      << msecs(m_phaseNsecs[Sorting]) << " ms, post-processing " << msecs(m_phaseNsecs[PostProcessing])
+                                                      << " ms, delivery " << msecs(m_phaseNsecs[Delivery]) << " ms, total " << msecs(m_timer.nsecsElapsed())
+                                                      << " ms";
+}
+
+QSharedPointer<KZoneAllocator> KCompTreeNode::m_alloc(new KZoneAllocator(s_nodeBlockSize));
 
 #include "moc_kcompletion.cpp"
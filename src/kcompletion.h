@@ -13,7 +13,9 @@
 #include <QKeySequence>
 #include <QObject>
 #include <QPointer>
+#include <QSharedDataPointer>
 #include <QStringList>
+#include <chrono>
 #include <functional>
 #include <memory>
 
@@ -21,6 +23,7 @@ class KCompTreeNode;
 class KCompletionPrivate;
 class KCompletionMatchesWrapper;
 class KCompletionMatches;
+class KCompletionStatisticsPrivate;
 
 /*!
  * \class KCompletion
@@ -112,6 +115,14 @@ class KCompletionMatches;
  * special cases (like reading directories or urls and then supplying the
  * contents to KCompletion, as KUrlCompletion does), but this is usually
  * not necessary.
+ *
+ * To find out which completion objects are slow, enable the debug output of
+ * the kf.completion.trace logging category, e.g. with
+ * QT_LOGGING_RULES="kf.completion.trace.debug=true". Every call of
+ * makeCompletion(), allMatches() and substringCompletion() then logs the
+ * length of the string to complete, the number of tree nodes visited and of
+ * matches extracted, and the time spent sorting, post-processing and
+ * delivering the matches.
  */
 class KCOMPLETION_EXPORT KCompletion : public QObject
 {
@@ -179,6 +190,102 @@ public:
      */
     using SorterFunction = std::function<void(QStringList &)>;
 
+    /*!
+     * \class KCompletion::Statistics
+     * \inmodule KCompletion
+     *
+     * \brief What a completion object did since it was created or since
+     * resetStatistics() was called.
+     *
+     * The queries counted are makeCompletion(), allMatches(),
+     * allWeightedMatches(), streamMatches() and substringCompletion().
+     *
+     * \sa statistics
+     * \since 6.30
+     */
+    class KCOMPLETION_EXPORT Statistics
+    {
+    public:
+        /*!
+         * Creates statistics where everything is zero.
+         */
+        Statistics();
+
+        Statistics(const Statistics &other);
+
+        Statistics &operator=(const Statistics &other);
+
+        ~Statistics();
+
+        /*!
+         * Returns the number of makeCompletion() calls in completion \a mode.
+         */
+        quint64 completions(CompletionMode mode) const;
+
+        /*!
+         * Returns the number of the other queries.
+         */
+        quint64 matchQueries() const;
+
+        /*!
+         * Returns the number of queries answered from the result cache, see
+         * setResultCacheSize().
+         */
+        quint64 resultCacheHits() const;
+
+        /*!
+         * Returns the number of queries that had to search the items while
+         * the result cache was enabled.
+         */
+        quint64 resultCacheMisses() const;
+
+        /*!
+         * Returns how often all completions of a string were searched in the
+         * items. Queries answered from the result cache or with the matches
+         * of the last makeCompletion() call don't search.
+         */
+        quint64 matchSearches() const;
+
+        /*!
+         * Returns the number of matches returned by all queries.
+         * makeCompletion() returns one match, unless it emits all matches in
+         * shell completion mode.
+         */
+        quint64 totalMatches() const;
+
+        /*!
+         * Returns the largest number of matches returned by a single query.
+         */
+        quint64 maxMatches() const;
+
+        /*!
+         * Returns the time spent answering the queries, including
+         * post-processing and the slots connected to the signals emitted.
+         */
+        std::chrono::nanoseconds totalTime() const;
+
+        /*!
+         * Returns the number of items added and removed, and of clear() calls.
+         */
+        quint64 treeMutations() const;
+
+        /*!
+         * Returns the number of queries.
+         */
+        quint64 queries() const;
+
+        /*!
+         * Returns the average number of matches returned per query.
+         */
+        double averageMatches() const;
+
+    private:
+        friend class KCompletion;
+        explicit Statistics(KCompletionStatisticsPrivate *dd);
+
+        QSharedDataPointer<KCompletionStatisticsPrivate> d;
+    };
+
     /*!
      * Constructor, nothing special here :)
      */
@@ -297,6 +404,32 @@ public:
      */
     bool ignoreCase() const;
 
+    /*!
+     * Setting this to true makes KCompletion keep a copy of every inserted
+     * item. Matches are then returned as implicitly shared copies of the
+     * inserted strings instead of being rebuilt character by character from
+     * the completion tree, which saves allocations when queries return many
+     * matches, at the cost of keeping the items in memory twice.
+     *
+     * This applies to case sensitive and case insensitive matches alike.
+     *
+     * Default is \c false.
+     *
+     * \a enable true to intern the inserted items
+     *
+     * \sa itemInterning
+     * \since 6.30
+     */
+    void setItemInterning(bool enable);
+
+    /*!
+     * Returns whether inserted items are interned.
+     *
+     * \sa setItemInterning
+     * \since 6.30
+     */
+    bool itemInterning() const;
+
     /*!
      * Informs the caller if they should display the auto-suggestion for the last completion operation performed.
      *
@@ -321,6 +454,18 @@ public:
      */
     QStringList allMatches(const QString &string);
 
+    /*!
+     * Returns the first \a limit items matching \a string, ordered like
+     * allMatches(\a string) would. A negative \a limit returns all matches.
+     *
+     * In Insertion order, case sensitive, only as many items as requested
+     * are looked at, otherwise all matches are still searched, but only the
+     * returned ones are sorted in Weighted order.
+     *
+     * \since 6.30
+     */
+    QStringList allMatches(const QString &string, int limit);
+
     /*!
      * Returns a list of all items matching the last completed string.
      * It might take some time if you have a lot of items.
@@ -384,6 +529,221 @@ public:
      */
     bool hasMultipleMatches() const;
 
+    /*!
+     * Sets the number of matches returned at once by streamMatches().
+     *
+     * Default is 0, which makes streamMatches() return all matches at once.
+     *
+     * \a size the number of matches per chunk
+     *
+     * \sa matchChunkSize, streamMatches
+     * \since 6.30
+     */
+    void setMatchChunkSize(int size);
+
+    /*!
+     * Returns the number of matches returned at once by streamMatches().
+     *
+     * \sa setMatchChunkSize
+     * \since 6.30
+     */
+    int matchChunkSize() const;
+
+    /*!
+     * Returns the first matchChunkSize() items matching \a string, ordered
+     * like allMatches() would.
+     *
+     * The remaining matches are emitted in chunks of matchChunkSize() items
+     * via moreMatches(), one chunk per event loop iteration, or immediately
+     * when calling fetchMoreMatches(), see setFetchMatchesOnDemand(). Only the matches of the first chunk
+     * need to be sorted before it is returned, so this is much faster than
+     * allMatches() for broad queries.
+     *
+     * Calling streamMatches() again, makeCompletion() or clear() cancels
+     * the delivery of the remaining matches.
+     *
+     * postProcessMatches() is called for every chunk.
+     *
+     * \sa hasMoreMatches, moreMatches
+     * \since 6.30
+     */
+    QStringList streamMatches(const QString &string);
+
+    /*!
+     * Sets the maximum number of queries whose matches are cached.
+     *
+     * makeCompletion(), allMatches(), allWeightedMatches() and
+     * streamMatches() reuse the matches of one of the last \a size
+     * queries when asked for the same string again, as long as no item was
+     * added or removed and the order, the case sensitivity and the sorter
+     * function didn't change in the meantime.
+     *
+     * As every cached query keeps all of its matches, the cache is meant for
+     * completion objects asked for the same strings over and over again,
+     * e.g. while typing and deleting in a line edit.
+     *
+     * Default is 0, which disables the cache.
+     *
+     * \sa resultCacheHits, resultCacheMisses
+     * \since 6.30
+     */
+    void setResultCacheSize(int size);
+
+    /*!
+     * Returns the maximum number of queries whose matches are cached.
+     *
+     * \sa setResultCacheSize
+     * \since 6.30
+     */
+    int resultCacheSize() const;
+
+    /*!
+     * Returns how many queries were answered from the result cache so far, see
+     * resetStatistics().
+     *
+     * \sa resultCacheMisses, setResultCacheSize, statistics
+     * \since 6.30
+     */
+    quint64 resultCacheHits() const;
+
+    /*!
+     * Returns how many queries had to search the items so far, see
+     * resetStatistics().
+     *
+     * \sa resultCacheHits, setResultCacheSize, statistics
+     * \since 6.30
+     */
+    quint64 resultCacheMisses() const;
+
+    /*!
+     * Sets whether the matches following the first chunk returned by
+     * streamMatches() are only delivered when calling fetchMoreMatches(),
+     * instead of once per event loop iteration.
+     *
+     * In Insertion order, case sensitive, the matches are then also only
+     * searched chunk by chunk, so the cost of streamMatches() and
+     * fetchMoreMatches() doesn't depend on the total number of matches.
+     * In popup completion mode, makeCompletion() then doesn't search for all
+     * matches either.
+     *
+     * Changing the items ends the delivery of the matches.
+     *
+     * Default is \c false.
+     *
+     * \sa fetchMatchesOnDemand
+     * \since 6.30
+     */
+    void setFetchMatchesOnDemand(bool onDemand);
+
+    /*!
+     * Returns whether the matches after the first chunk returned by
+     * streamMatches() are only delivered by fetchMoreMatches().
+     *
+     * \sa setFetchMatchesOnDemand
+     * \since 6.30
+     */
+    bool fetchMatchesOnDemand() const;
+
+    /*!
+     * Returns \c true if streamMatches() has matches left to deliver.
+     *
+     * \sa fetchMoreMatches
+     * \since 6.30
+     */
+    bool hasMoreMatches() const;
+
+    /*!
+     * Sets the number of items from which on insertItems() and setItems()
+     * build the tree on several threads of QThreadPool::globalInstance().
+     *
+     * The items are split by their first characters, and the items sharing
+     * them are inserted by the same thread. The result is the same as
+     * inserting the items one after the other, including their weights and
+     * the order of the matches. This pays off for corpora of hundreds of
+     * thousands of items and more.
+     *
+     * Once the completion object holds at least that many items,
+     * substringCompletion() and the matching with ignoreCase() set, which
+     * look at all items below the typed string, are spread over the threads
+     * as well. The matches are returned in the same order as before.
+     *
+     * Default is 0, which always inserts and searches the items on the
+     * calling thread.
+     *
+     * \a itemCount the minimum number of items to insert or search in parallel
+     *
+     * \sa parallelThreshold
+     * \since 6.30
+     */
+    void setParallelThreshold(int itemCount);
+
+    /*!
+     * Returns the number of items from which on they are inserted and
+     * searched in parallel, or 0 if they never are.
+     *
+     * \sa setParallelThreshold
+     * \since 6.30
+     */
+    int parallelThreshold() const;
+
+    /*!
+     * Requests a turn to complete \a string on behalf of \a requester,
+     * usually the widget the string was typed into, and returns right away.
+     * Once control returns to the event loop and it is the requester's turn,
+     * completionReady() is emitted and the requester completes the string
+     * itself, e.g. with makeCompletion().
+     *
+     * This is meant for several widgets sharing this completion object: a
+     * request supersedes the pending request of the same requester, the
+     * request of the requester having the focus (or containing the focus
+     * object) is handled first, and only one request is handled per event
+     * loop iteration. Superseded and canceled requests are never searched.
+     * Requesters completing the same strings share their matches only if
+     * the result cache is enabled, see setResultCacheSize().
+     *
+     * Requests themselves don't change the state used by previousMatch(),
+     * nextMatch() and allMatches() without arguments.
+     *
+     * \sa cancelCompletionRequest
+     * \since 6.30
+     */
+    void requestCompletion(QObject *requester, const QString &string);
+
+    /*!
+     * Drops the pending request of \a requester, if any.
+     *
+     * \sa requestCompletion
+     * \since 6.30
+     */
+    void cancelCompletionRequest(QObject *requester);
+
+    /*!
+     * Returns \c true if \a requester has a pending request.
+     *
+     * \sa requestCompletion
+     * \since 6.30
+     */
+    bool hasCompletionRequest(QObject *requester) const;
+
+    /*!
+     * Returns what this completion object did since it was created or since
+     * the last resetStatistics() call, e.g. to find the completion objects
+     * that would benefit from a different order() or fewer items.
+     *
+     * \sa resetStatistics
+     * \since 6.30
+     */
+    Statistics statistics() const;
+
+    /*!
+     * Resets the statistics to zero, including resultCacheHits() and
+     * resultCacheMisses().
+     *
+     * \sa statistics
+     * \since 6.30
+     */
+    void resetStatistics();
+
 public Q_SLOTS:
     /*!
      * Attempts to find an item in the list of available completions
@@ -497,6 +857,16 @@ public Q_SLOTS:
      */
     virtual void clear();
 
+    /*!
+     * Emits the next chunk of the matches of the last call to streamMatches()
+     * via moreMatches() right away, instead of waiting for the event loop.
+     *
+     * Does nothing if hasMoreMatches() is \c false.
+     *
+     * \since 6.30
+     */
+    void fetchMoreMatches();
+
 Q_SIGNALS:
     /*!
      * This signal is emitted when a match is found.
@@ -527,6 +897,25 @@ Q_SIGNALS:
      */
     void multipleMatches();
 
+    /*!
+     * This signal is emitted for every further chunk of matches after
+     * streamMatches() returned the first one.
+     *
+     * \a chunk the next matching items
+     *
+     * \sa streamMatches
+     * \since 6.30
+     */
+    void moreMatches(const QStringList &chunk);
+
+    /*!
+     * Emitted when it is the turn of \a requester to complete \a string,
+     * as requested with requestCompletion().
+     *
+     * \since 6.30
+     */
+    void completionReady(QObject *requester, const QString &string);
+
 protected:
     /*!
      * This method is called after a completion is found and before the
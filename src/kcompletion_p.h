@@ -10,13 +10,78 @@
 
 #include "kcompletion.h"
 #include "kcompletionmatcheswrapper_p.h"
+#include "kcompletiontrace_p.h"
 #include "kcomptreenode_p.h"
 
 #include <kcompletionmatches.h>
 
+#include <QCache>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QPointer>
 #include <QSharedPointer>
+#include <QThreadPool>
 #include <kzoneallocator_p.h>
 
+#include <algorithm>
+#include <functional>
+#include <optional>
+
+// The parameters of a query that determine its matches
+struct KCompletionCacheKey {
+    QString string;
+    bool ignoreCase;
+    KCompletion::CompOrder order;
+
+    bool operator==(const KCompletionCacheKey &other) const
+    {
+        return string == other.string && ignoreCase == other.ignoreCase && order == other.order;
+    }
+};
+
+inline size_t qHash(const KCompletionCacheKey &key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.string, key.ignoreCase, int(key.order));
+}
+
+struct KCompletionCachedMatches {
+    KCompletionCachedMatches(KCompletion::SorterFunction const &sorterFunction, KCompletion::CompOrder order, uint generation)
+        : matches(sorterFunction, order)
+        , generation(generation)
+    {
+    }
+
+    KCompletionMatchesWrapper matches;
+    // the tree generation the matches were computed for
+    uint generation;
+    bool hasMultipleMatches = false;
+};
+
+// What KCompletion::Statistics reports
+struct KCompletionStatisticsCounters {
+    QMap<KCompletion::CompletionMode, quint64> completions;
+    quint64 matchQueries = 0;
+    quint64 resultCacheHits = 0;
+    quint64 resultCacheMisses = 0;
+    quint64 matchSearches = 0;
+    quint64 totalMatches = 0;
+    quint64 maxMatches = 0;
+    std::chrono::nanoseconds totalTime{0};
+    quint64 treeMutations = 0;
+};
+
+class KCompletionStatisticsPrivate : public QSharedData
+{
+public:
+    KCompletionStatisticsCounters counters;
+};
+
+// A pending KCompletion::requestCompletion()
+struct KCompletionRequest {
+    QPointer<QObject> requester;
+    QString string;
+};
+
 class KCompletionPrivate
 {
 public:
@@ -29,14 +94,93 @@ public:
         , beep(true)
         , ignoreCase(false)
         , shouldAutoSuggest(true)
+        , internItems(false)
+        , fetchMatchesOnDemand(false)
     {
     }
 
     ~KCompletionPrivate() = default;
 
     void addWeightedItem(const QString &);
+
+    // Whether inserting or scanning itemCount items is spread over several
+    // threads, see KCompletion::setParallelThreshold()
+    bool runsInParallel(qsizetype itemCount) const
+    {
+        return parallelThreshold > 0 && itemCount >= parallelThreshold && QThreadPool::globalInstance()->maxThreadCount() > 1;
+    }
+
+    // Inserts the items on several threads
+    void insertItemsInParallel(const QStringList &items);
+
+    // Adds item to the pool, unless an equal one was inserted before
+    void internItem(const KCompTreeNode *terminator, const QString &item);
     QString findCompletion(const QString &string);
 
+    // Returns the 0x0 node terminating item in the tree, or nullptr
+    const KCompTreeNode *findItemNode(const QString &item) const;
+
+    // Interns all items below node, prefix being the string leading to node
+    void fillItemPool(const KCompTreeNode *node, QString &prefix);
+
+    const KCompTreeItemPool *itemPoolOrNull() const
+    {
+        return internItems ? &itemPool : nullptr;
+    }
+
+    /*
+     * Fills matches with all completions of string, taking them from the result
+     * cache if possible. If sort is true, matches is fully sorted already,
+     * sorting is then done only once per cached query.
+     */
+    void findAllCompletions(KCompletionMatchesWrapper &matches, const QString &string, bool sort, bool &hasMultipleMatches);
+
+    // Fills matches with all completions of string, for rotating through them
+    void findLastMatches(const QString &string, bool sort);
+
+    // Returns matches if they hold all completions of string as a search
+    // would find them now, or nullptr
+    KCompletionMatchesWrapper *lastMatchesOf(const QString &string);
+
+    // Fills matches with all completions of string, without the result cache
+    void findMatches(KCompletionMatchesWrapper &matches, const QString &string, bool &hasMultipleMatches) const;
+
+    // Adds the items below the subtrees to matches, in this order, or only the
+    // ones filter returns true for. Large trees are scanned on several threads.
+    void extractMatches(KCompletionMatchesWrapper &matches,
+                        const QList<KCompTreeSubtree> &subtrees,
+                        const std::function<bool(const QString &)> &filter = {}) const;
+
+    // Invalidates the cached results, to be called whenever the matches of a query may change
+    void itemsChanged()
+    {
+        ++generation;
+        // its nodes might go away
+        matchWalker.reset();
+    }
+
+    // Whether the order of the matches is the order of the tree, so that
+    // they can be found one after the other with a KCompTreeItemWalker
+    bool canWalkMatches() const
+    {
+        return order == KCompletion::Insertion && !ignoreCase;
+    }
+
+    // Returns a walker over the items starting with string, or nullptr if there are none
+    std::unique_ptr<KCompTreeItemWalker> walkMatches(const QString &string) const;
+    // Returns the next count matches of matchWalker
+    QStringList walkNextMatches(qsizetype count);
+
+    // Stops delivering the matches of KCompletion::streamMatches()
+    void cancelMatchStream();
+    // Takes the next chunk of matches to deliver via KCompletion::moreMatches()
+    QStringList takeMatchChunk();
+    void scheduleMatchChunk();
+
+    // Handles the next request in the next event loop iteration
+    void scheduleRequest();
+    void handleNextRequest();
+
     // The default sorting function, sorts alphabetically
     static void defaultSort(QStringList &);
 
@@ -45,6 +189,9 @@ public:
 
     // list used for nextMatch() and previousMatch()
     KCompletionMatchesWrapper matches{sorterFunction};
+    // the query matches holds all completions of, see lastMatchesOf()
+    std::optional<KCompletionCacheKey> lastMatchesQuery;
+    uint lastMatchesGeneration = 0;
 
     KCompletion *const q_ptr;
     KCompletion::CompletionMode completionMode;
@@ -55,7 +202,32 @@ public:
     QString lastMatch;
     QString currentMatch;
     std::unique_ptr<KCompTreeNode> m_treeRoot;
+    // the inserted items, if internItems is set
+    KCompTreeItemPool itemPool;
+    // the number of distinct items in the tree
+    qsizetype itemCount = 0;
+    // the results of the last queries, see findAllCompletions()
+    QCache<KCompletionCacheKey, KCompletionCachedMatches> resultCache{0};
+    uint generation = 0;
+    // see KCompletion::statistics(), const queries count as well
+    mutable KCompletionStatisticsCounters statistics;
+    // the number of queries being answered, only the outermost one is counted
+    mutable int queryDepth = 0;
     int rotationIndex = 0;
+    int matchChunkSize = 0;
+    // see KCompletion::setParallelThreshold()
+    int parallelThreshold = 0;
+    // matches of KCompletion::streamMatches(), only sorted once the second
+    // chunk is needed
+    std::unique_ptr<KCompletionMatchesWrapper> streamedMatches;
+    // or the position of the next match if they are fetched on demand
+    std::unique_ptr<KCompTreeItemWalker> matchWalker;
+    QStringList streamedList;
+    qsizetype streamedCount = 0;
+    // invalidates the scheduled deliveries of a canceled stream
+    uint streamId = 0;
+    QList<KCompletionRequest> requests;
+    bool requestScheduled = false;
     // TODO: Change hasMultipleMatches to bitfield after moving findAllCompletions()
     // to KCompletionMatchesPrivate
     KCompletion::CompOrder order : 3;
@@ -63,7 +235,65 @@ public:
     bool beep : 1;
     bool ignoreCase : 1;
     bool shouldAutoSuggest : 1;
+    bool internItems : 1;
+    bool fetchMatchesOnDemand : 1;
     Q_DECLARE_PUBLIC(KCompletion)
 };
 
+/*
+ * Counts a query of KCompletion in its statistics, and traces it. Queries
+ * made while answering another one are only traced.
+ */
+class KCompletionQuery
+{
+public:
+    // mode is the completion mode of a makeCompletion() call, CompletionNone for the other queries
+    KCompletionQuery(const KCompletionPrivate *d,
+                     const char *operation,
+                     const QString &string,
+                     KCompletion::CompletionMode mode = KCompletion::CompletionNone)
+        : m_trace(d->q_ptr, operation, string)
+        , m_d(d)
+        , m_outermost(d->queryDepth++ == 0)
+    {
+        if (!m_outermost) {
+            return;
+        }
+        if (mode == KCompletion::CompletionNone) {
+            ++d->statistics.matchQueries;
+        } else {
+            ++d->statistics.completions[mode];
+        }
+        m_timer.start();
+    }
+
+    ~KCompletionQuery()
+    {
+        --m_d->queryDepth;
+        if (m_outermost) {
+            KCompletionStatisticsCounters &statistics = m_d->statistics;
+            statistics.totalTime += std::chrono::nanoseconds(m_timer.nsecsElapsed());
+            statistics.totalMatches += m_resultCount;
+            statistics.maxMatches = std::max(statistics.maxMatches, m_resultCount);
+        }
+    }
+
+    KCompletionQuery(const KCompletionQuery &) = delete;
+    KCompletionQuery &operator=(const KCompletionQuery &) = delete;
+
+    // Sets the number of matches returned or emitted
+    void setResultCount(qsizetype count)
+    {
+        m_trace.setResultCount(count);
+        m_resultCount = quint64(count);
+    }
+
+private:
+    KCompletionTrace m_trace;
+    const KCompletionPrivate *const m_d;
+    const bool m_outermost;
+    quint64 m_resultCount = 0;
+    QElapsedTimer m_timer;
+};
+
 #endif // KCOMPLETION_PRIVATE_H
@@ -12,20 +12,261 @@
 #include "klineedit.h"
 
 #include <QApplication>
+#include <QHash>
 #include <QKeyEvent>
+#include <QPointer>
 #include <QScreen>
 #include <QScrollBar>
+#include <QTimer>
+#include <QWindow>
+
+#include <algorithm>
+#include <vector>
+
+// number of rows created at once in lazy loading mode, more than fit in the box
+static constexpr int s_lazyBatchSize = 64;
 
 class KCompletionBoxPrivate
 {
 public:
+    bool hasLazyRows() const
+    {
+        return lazyOffset < lazyItems.size();
+    }
+
+    void createLazyRows(KCompletionBox *q, qsizetype rows);
+    void fetchLastRows(KCompletionBox *q);
+    bool updateRows(KCompletionBox *q, const QStringList &items, QListWidgetItem *&current);
+    void scheduleGeometryUpdate(KCompletionBox *q);
+    void installEventFilters(KCompletionBox *q);
+    void removeEventFilters(KCompletionBox *q);
+
     QWidget *m_parent = nullptr; // necessary to set the focus back
     QString cancelText;
+    // in lazy loading mode, the items whose rows are not created yet start at lazyOffset
+    QStringList lazyItems;
+    // the window of m_parent and its QWindow, filtered while the box is visible
+    QPointer<QWidget> filteredWindow;
+    QPointer<QWindow> filteredWindowHandle;
+    QMetaObject::Connection focusWindowConnection;
+    qsizetype lazyOffset = 0;
+    // all rows have the same height (uniformItemSizes), -1 until it is known
+    int rowHeight = -1;
     bool tabHandling = true;
     bool upwardBox = false;
     bool emitSelected = true;
+    bool lazyLoading = false;
+    bool canFetchMoreItems = false;
+    bool geometryUpdatePending = false;
 };
 
+// Resizes and repositions the box once control returns to the event loop, so
+// that several changes in a row cause a single geometry update
+void KCompletionBoxPrivate::scheduleGeometryUpdate(KCompletionBox *q)
+{
+    if (geometryUpdatePending) {
+        return;
+    }
+    geometryUpdatePending = true;
+    QTimer::singleShot(0, q, [this, q]() {
+        geometryUpdatePending = false;
+        if (q->isVisible() && q->size() != q->sizeHint()) {
+            q->resizeAndReposition();
+        }
+    });
+}
+
+// Creates the rows of the next items in lazyItems, all of them if rows is -1
+void KCompletionBoxPrivate::createLazyRows(KCompletionBox *q, qsizetype rows)
+{
+    const qsizetype remaining = lazyItems.size() - lazyOffset;
+    if (remaining <= 0) {
+        return;
+    }
+    if (rows < 0 || rows > remaining) {
+        rows = remaining;
+    }
+
+    const QStringList items = lazyItems.mid(lazyOffset, rows);
+    lazyOffset += rows;
+    if (lazyOffset >= lazyItems.size()) {
+        lazyItems.clear();
+        lazyOffset = 0;
+    }
+
+    bool block = q->signalsBlocked();
+    q->blockSignals(true);
+    q->addItems(items);
+    q->blockSignals(block);
+}
+
+// Returns for every value whether it is part of a longest increasing subsequence
+static std::vector<bool> longestIncreasingSubsequence(const QList<qsizetype> &values)
+{
+    std::vector<bool> result(values.size(), false);
+    // tails[length - 1]: position of the smallest last value of a subsequence of that length
+    std::vector<qsizetype> tails;
+    std::vector<qsizetype> previous(values.size(), -1);
+    for (qsizetype i = 0; i < values.size(); ++i) {
+        const auto it = std::lower_bound(tails.begin(), tails.end(), values.at(i), [&values](qsizetype pos, qsizetype value) {
+            return values.at(pos) < value;
+        });
+        if (it != tails.begin()) {
+            previous[i] = *(it - 1);
+        }
+        if (it == tails.end()) {
+            tails.push_back(i);
+        } else {
+            *it = i;
+        }
+    }
+    for (qsizetype i = tails.empty() ? -1 : tails.back(); i >= 0; i = previous[i]) {
+        result[i] = true;
+    }
+    return result;
+}
+
+/*
+ * Turns the rows into items with few row removals, insertions and moves,
+ * keeping the QListWidgetItem of every text that is still there. current is
+ * reset if its row is removed. Returns false, without touching the rows, if the
+ * texts are not unique.
+ */
+bool KCompletionBoxPrivate::updateRows(KCompletionBox *q, const QStringList &items, QListWidgetItem *&current)
+{
+    QHash<QString, qsizetype> newRows;
+    newRows.reserve(items.size());
+    for (qsizetype i = 0; i < items.size(); ++i) {
+        newRows.insert(items.at(i), i);
+    }
+    if (newRows.size() != items.size()) {
+        return false;
+    }
+
+    // the new row of every row, -1 if its text is gone
+    QList<qsizetype> targets(q->count(), -1);
+    std::vector<bool> found(items.size(), false);
+    for (int row = 0; row < q->count(); ++row) {
+        const qsizetype target = newRows.value(q->item(row)->text(), -1);
+        if (target >= 0) {
+            if (found[target]) {
+                return false;
+            }
+            found[target] = true;
+        }
+        targets[row] = target;
+    }
+    if (current && targets.at(q->row(current)) < 0) {
+        current = nullptr;
+    }
+
+    // remove the rows whose text is gone, a range at a time
+    for (int row = q->count() - 1; row >= 0;) {
+        if (targets.at(row) >= 0) {
+            --row;
+            continue;
+        }
+        int first = row;
+        while (first > 0 && targets.at(first - 1) < 0) {
+            --first;
+        }
+        q->model()->removeRows(first, row - first + 1);
+        targets.remove(first, row - first + 1);
+        row = first - 1;
+    }
+
+    // the rows in the longest run already in the new order stay, the others
+    // are taken out and put back at their new place
+    const std::vector<bool> keep = longestIncreasingSubsequence(targets);
+    std::vector<QListWidgetItem *> movedItems(items.size(), nullptr);
+    QList<qsizetype> keptTargets;
+    keptTargets.reserve(targets.size());
+    for (int row = targets.size() - 1; row >= 0; --row) {
+        if (!keep[row]) {
+            movedItems[targets.at(row)] = q->takeItem(row);
+        }
+    }
+    for (qsizetype i = 0; i < targets.size(); ++i) {
+        if (keep[i]) {
+            keptTargets.append(targets.at(i));
+        }
+    }
+
+    qsizetype kept = 0;
+    for (qsizetype i = 0; i < items.size();) {
+        if (kept < keptTargets.size() && keptTargets.at(kept) == i) {
+            ++kept;
+            ++i;
+        } else if (movedItems[i]) {
+            q->insertItem(int(i), movedItems[i]);
+            ++i;
+        } else {
+            // insert all new texts up to the next existing item at once
+            qsizetype end = i + 1;
+            while (end < items.size() && !movedItems[end] && !(kept < keptTargets.size() && keptTargets.at(kept) == end)) {
+                ++end;
+            }
+            q->QListWidget::insertItems(int(i), items.mid(i, end - i));
+            i = end;
+        }
+    }
+    return true;
+}
+
+/*
+ * Installs the event filters needed while the box is visible: on the parent for
+ * keys, focus and geometry changes, on its window to hide on moves, and on that
+ * window's QWindow, which sees every mouse press in it first. Mouse presses in
+ * other windows move the focus there.
+ */
+void KCompletionBoxPrivate::installEventFilters(KCompletionBox *q)
+{
+    removeEventFilters(q);
+
+    m_parent->installEventFilter(q);
+    filteredWindow = m_parent->window();
+    if (filteredWindow != m_parent) {
+        filteredWindow->installEventFilter(q);
+    }
+    filteredWindowHandle = filteredWindow->windowHandle();
+    if (filteredWindowHandle) {
+        filteredWindowHandle->installEventFilter(q);
+    }
+
+    focusWindowConnection = QObject::connect(qGuiApp, &QGuiApplication::focusWindowChanged, q, [this, q](QWindow *window) {
+        if (window && window != filteredWindowHandle && window != q->windowHandle()) {
+            q->hide();
+        }
+    });
+}
+
+void KCompletionBoxPrivate::removeEventFilters(KCompletionBox *q)
+{
+    if (m_parent) {
+        m_parent->removeEventFilter(q);
+    }
+    if (filteredWindow) {
+        filteredWindow->removeEventFilter(q);
+    }
+    if (filteredWindowHandle) {
+        filteredWindowHandle->removeEventFilter(q);
+    }
+    filteredWindow.clear();
+    filteredWindowHandle.clear();
+    QObject::disconnect(focusWindowConnection);
+}
+
+// Creates all remaining rows and requests a single chunk of items on top,
+// the engine isn't asked for all of its items, there may be millions
+void KCompletionBoxPrivate::fetchLastRows(KCompletionBox *q)
+{
+    createLazyRows(q, -1);
+    if (canFetchMoreItems) {
+        Q_EMIT q->fetchMoreRequested();
+        createLazyRows(q, -1);
+    }
+}
+
 KCompletionBox::KCompletionBox(QWidget *parent)
     : QListWidget(parent)
     , d(new KCompletionBoxPrivate)
@@ -52,6 +293,18 @@ KCompletionBox::KCompletionBox(QWidget *parent)
     setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
     setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
 
+    // QListWidget::clear() resets the model, the remaining lazy items go away too
+    connect(model(), &QAbstractItemModel::modelReset, this, [this]() {
+        d->lazyItems.clear();
+        d->lazyOffset = 0;
+        d->canFetchMoreItems = false;
+    });
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, [this](int value) {
+        if (value >= verticalScrollBar()->maximum() && canFetchMore()) {
+            fetchMore();
+        }
+    });
+
     connect(this, &QListWidget::itemDoubleClicked, this, &KCompletionBox::slotActivated);
     connect(this, &KCompletionBox::itemClicked, this, [this](QListWidgetItem *item) {
         if (item) {
@@ -70,12 +323,15 @@ KCompletionBox::~KCompletionBox()
 QStringList KCompletionBox::items() const
 {
     QStringList list;
-    list.reserve(count());
+    list.reserve(count() + d->lazyItems.size() - d->lazyOffset);
     for (int i = 0; i < count(); i++) {
         const QListWidgetItem *currItem = item(i);
 
         list.append(currItem->text());
     }
+    if (d->hasLazyRows()) {
+        list += d->lazyItems.mid(d->lazyOffset);
+    }
 
     return list;
 }
@@ -90,18 +346,32 @@ void KCompletionBox::slotActivated(QListWidgetItem *item)
 
 bool KCompletionBox::eventFilter(QObject *o, QEvent *e)
 {
+    if (d->filteredWindowHandle && o == d->filteredWindowHandle.data()) {
+        if (e->type() == QEvent::MouseButtonPress) {
+            // the box is a window of its own, so this press is outside of it
+            const QWidget *target = d->filteredWindow ? d->filteredWindow->childAt(static_cast<QMouseEvent *>(e)->position().toPoint()) : nullptr;
+            if (!d->emitSelected && currentItem() && !qobject_cast<const QScrollBar *>(target)) {
+                Q_EMIT currentTextChanged(currentItem()->text());
+            }
+            hide();
+            e->accept();
+            return true;
+        }
+        return QListWidget::eventFilter(o, e);
+    }
+
     if (o != this) {
         if (const auto *const wid = qobject_cast<QWidget *>(o)) {
             const int type = e->type();
 
             if (type == QEvent::Resize) {
                 if (wid == d->m_parent) {
-                    resizeAndReposition();
+                    d->scheduleGeometryUpdate(this);
                     return false;
                 }
             } else if (type == QEvent::Move) {
                 if (wid == d->m_parent) {
-                    resizeAndReposition();
+                    d->scheduleGeometryUpdate(this);
                     return false;
                 }
 
@@ -321,42 +591,47 @@ void KCompletionBox::setVisible(bool visible)
     if (visible) {
         d->upwardBox = false;
         if (d->m_parent) {
+            // Lay out the parent first so that the box is placed at its final
+            // geometry. Only its own pending layout requests and those of its
+            // ancestors are processed, not the ones of the whole application.
+            for (QWidget *w = d->m_parent; w; w = w->isWindow() ? nullptr : w->parentWidget()) {
+                QCoreApplication::sendPostedEvents(w, QEvent::LayoutRequest);
+            }
             resizeAndReposition();
-            qApp->installEventFilter(this);
         }
-
-        // FIXME: Is this comment still valid or can it be deleted? Is a patch already sent to Qt?
-        // Following lines are a workaround for a bug (not sure whose this is):
-        // If this KCompletionBox' parent is in a layout, that layout will detect the
-        // insertion of a new child (posting a ChildInserted event). Then it will trigger relayout
-        // (posting a LayoutHint event).
-        //
-        // QWidget::show() then sends also posted ChildInserted events for the parent,
-        // and later all LayoutHint events, which cause layout updating.
-        // The problem is that KCompletionBox::eventFilter() detects the resizing
-        // of the parent, calls hide() and this hide() happens in the middle
-        // of show(), causing inconsistent state. I'll try to submit a Qt patch too.
-        qApp->sendPostedEvents();
     } else {
         if (d->m_parent) {
-            qApp->removeEventFilter(this);
+            d->removeEventFilters(this);
         }
         d->cancelText.clear();
     }
 
     QListWidget::setVisible(visible);
+
+    // Only filter events once shown: if showing the box makes the layout of the
+    // parent move or resize it, that must not hide the box in the middle of show().
+    if (visible && d->m_parent && isVisible()) {
+        d->installEventFilters(this);
+    }
 }
 
 QRect KCompletionBox::calculateGeometry() const
 {
-    QRect visualRect;
-    if (count() == 0 || !(visualRect = visualItemRect(item(0))).isValid()) {
+    if (count() == 0) {
         return QRect();
     }
+    if (d->rowHeight < 0) {
+        // visualItemRect() lays out the items first, only do that once
+        const QRect visualRect = visualItemRect(item(0));
+        if (!visualRect.isValid()) {
+            return QRect();
+        }
+        d->rowHeight = visualRect.height();
+    }
 
     int x = 0;
     int y = 0;
-    int ih = visualRect.height();
+    int ih = d->rowHeight;
     int h = qMin(15 * ih, count() * ih) + 2 * frameWidth();
 
     int w = (d->m_parent) ? d->m_parent->width() : QListWidget::minimumSizeHint().width();
@@ -369,9 +644,23 @@ QSize KCompletionBox::sizeHint() const
     return calculateGeometry().size();
 }
 
+void KCompletionBox::changeEvent(QEvent *event)
+{
+    if (event->type() == QEvent::FontChange || event->type() == QEvent::StyleChange) {
+        d->rowHeight = -1;
+        if (isVisible()) {
+            d->scheduleGeometryUpdate(this);
+        }
+    }
+    QListWidget::changeEvent(event);
+}
+
 void KCompletionBox::down()
 {
     const int row = currentRow();
+    if (row >= count() - 1 && canFetchMore()) {
+        fetchMore();
+    }
     const int lastRow = count() - 1;
     if (row < lastRow) {
         setCurrentRow(row + 1);
@@ -391,6 +680,7 @@ void KCompletionBox::up()
         return;
     }
 
+    d->fetchLastRows(this);
     const int lastRow = count() - 1;
     if (lastRow > 0) {
         setCurrentRow(lastRow);
@@ -399,6 +689,9 @@ void KCompletionBox::up()
 
 void KCompletionBox::pageDown()
 {
+    if (currentRow() + verticalScrollBar()->pageStep() >= count() - 1 && canFetchMore()) {
+        fetchMore();
+    }
     selectionModel()->setCurrentIndex(moveCursor(QAbstractItemView::MovePageDown, Qt::NoModifier), QItemSelectionModel::SelectCurrent);
 }
 
@@ -414,6 +707,7 @@ void KCompletionBox::home()
 
 void KCompletionBox::end()
 {
+    d->fetchLastRows(this);
     setCurrentRow(count() - 1);
 }
 
@@ -453,10 +747,26 @@ void KCompletionBox::setItems(const QStringList &items)
 
     int rowIndex = 0;
 
+    // in lazy loading mode, only the first rows are created right away
+    const qsizetype rows = d->lazyLoading ? qMin<qsizetype>(items.size(), s_lazyBatchSize) : items.size();
+    d->lazyItems.clear();
+    d->lazyOffset = 0;
+    d->canFetchMoreItems = false;
+    if (rows < items.size()) {
+        d->lazyItems = items;
+        d->lazyOffset = rows;
+    }
+
+    // keep the current item if its text is still there
+    QListWidgetItem *current = currentItem();
+    const QString currentText = current ? current->text() : QString();
+
     if (!count()) {
-        addItems(items);
-    } else {
-        for (const auto &text : items) {
+        addItems(items.mid(0, rows));
+    } else if (!d->updateRows(this, items.mid(0, rows), current)) {
+        // duplicated texts, simply overwrite the rows
+        for (; rowIndex < rows; ++rowIndex) {
+            const QString &text = items.at(rowIndex);
             if (rowIndex < count()) {
                 auto item = this->item(rowIndex);
                 if (item->text() != text) {
@@ -465,7 +775,6 @@ void KCompletionBox::setItems(const QStringList &items)
             } else {
                 addItem(text);
             }
-            rowIndex++;
         }
 
         // remove unused items with an index >= rowIndex
@@ -474,15 +783,83 @@ void KCompletionBox::setItems(const QStringList &items)
             Q_ASSERT(item);
             delete item;
         }
+
+        const QList<QListWidgetItem *> matchedItems = current ? findItems(currentText, Qt::MatchExactly) : QList<QListWidgetItem *>();
+        current = matchedItems.isEmpty() ? nullptr : matchedItems.first();
+    }
+
+    if (current) {
+        if (currentItem() != current) {
+            setCurrentItem(current);
+        }
+    } else if (currentRow() != -1) {
+        setCurrentRow(-1);
+    }
+
+    if (isVisible()) {
+        d->scheduleGeometryUpdate(this);
+    }
+
+    blockSignals(block);
+}
+
+void KCompletionBox::appendItems(const QStringList &items)
+{
+    if (items.isEmpty()) {
+        return;
+    }
+
+    bool block = signalsBlocked();
+    blockSignals(true);
+    if (d->hasLazyRows()) {
+        d->lazyItems += items;
+    } else if (d->lazyLoading && count() + items.size() > s_lazyBatchSize) {
+        const qsizetype rows = qMax(0, s_lazyBatchSize - count());
+        addItems(items.mid(0, rows));
+        d->lazyItems = items;
+        d->lazyOffset = rows;
+    } else {
+        addItems(items);
     }
 
-    if (isVisible() && size().height() != sizeHint().height()) {
-        resizeAndReposition();
+    if (isVisible()) {
+        d->scheduleGeometryUpdate(this);
     }
 
     blockSignals(block);
 }
 
+void KCompletionBox::setLazyLoading(bool enable)
+{
+    d->lazyLoading = enable;
+    if (!enable) {
+        d->createLazyRows(this, -1);
+    }
+}
+
+bool KCompletionBox::isLazyLoading() const
+{
+    return d->lazyLoading;
+}
+
+bool KCompletionBox::canFetchMore() const
+{
+    return d->hasLazyRows() || d->canFetchMoreItems;
+}
+
+void KCompletionBox::fetchMore()
+{
+    if (!d->hasLazyRows() && d->canFetchMoreItems) {
+        Q_EMIT fetchMoreRequested();
+    }
+    d->createLazyRows(this, s_lazyBatchSize);
+}
+
+void KCompletionBox::setCanFetchMore(bool canFetchMore)
+{
+    d->canFetchMoreItems = canFetchMore;
+}
+
 void KCompletionBox::setActivateOnSelect(bool doEmit)
 {
     d->emitSelected = doEmit;
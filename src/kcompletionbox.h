@@ -71,9 +71,51 @@ public:
 
     /*!
      * Returns a list of all items currently in the box.
+     *
+     * In lazy loading mode, this includes the items whose rows were not
+     * created yet.
+     *
+     * \sa setLazyLoading
      */
     QStringList items() const;
 
+    /*!
+     * Enables lazy loading of the rows.
+     *
+     * In this mode, setItems() and appendItems() only create the rows of the
+     * first items, a few more than fit into the box. The remaining rows are
+     * created in batches when scrolling to the end of the list or moving the
+     * current item past the last created row, so showing a huge number of
+     * matches costs about as much as showing a few. items() still returns
+     * all items, while count() only counts the rows created so far.
+     *
+     * Disabling lazy loading creates all remaining rows.
+     *
+     * Default is \c false.
+     *
+     * \sa isLazyLoading
+     * \since 6.30
+     */
+    void setLazyLoading(bool enable);
+
+    /*!
+     * Returns \c true if the rows are created lazily.
+     *
+     * \sa setLazyLoading
+     * \since 6.30
+     */
+    bool isLazyLoading() const;
+
+    /*!
+     * Returns \c true if more items can be shown, either because their rows
+     * were not created yet in lazy loading mode, or because setCanFetchMore()
+     * was called.
+     *
+     * \sa fetchMore
+     * \since 6.30
+     */
+    bool canFetchMore() const;
+
     /*!
      * Returns \c true if this widget is handling Tab-key events to traverse the
      * items in the dropdown list, otherwise false.
@@ -99,9 +141,47 @@ public Q_SLOTS:
 
     /*!
      * Clears the box and inserts \a items.
+     *
+     * Rows whose text is still in \a items are kept and only moved if needed,
+     * so that the current item stays selected. If its text is gone there is no
+     * current item afterwards.
      */
     void setItems(const QStringList &items);
 
+    /*!
+     * Appends \a items at the end of the box, keeping the current item and
+     * the selection, and resizes the box if needed.
+     *
+     * This is meant for showing matches delivered in chunks by
+     * KCompletion::streamMatches().
+     *
+     * \since 6.30
+     */
+    void appendItems(const QStringList &items);
+
+    /*!
+     * Creates the next rows in lazy loading mode. Once all rows are created,
+     * emits fetchMoreRequested() if setCanFetchMore() was called.
+     *
+     * This is called when scrolling to the end of the list or moving the
+     * current item past the last row.
+     *
+     * \sa canFetchMore
+     * \since 6.30
+     */
+    void fetchMore();
+
+    /*!
+     * Sets whether more items than the ones passed to setItems() and
+     * appendItems() are available, so that fetchMore() requests them via
+     * fetchMoreRequested().
+     *
+     * setItems() and clear() reset this to \c false.
+     *
+     * \since 6.30
+     */
+    void setCanFetchMore(bool canFetchMore);
+
     /*!
      * Adjusts the size of the box to fit the width of the parent given in the
      * constructor and pops it up at the most appropriate place, relative to
@@ -175,6 +255,10 @@ public Q_SLOTS:
 
     /*!
      * Moves the selection down to the last item.
+     *
+     * If setCanFetchMore() was called, one more chunk of items is requested
+     * via fetchMoreRequested() first, the selection moves to the last of
+     * the items received so far.
      */
     void end();
 
@@ -198,6 +282,14 @@ Q_SIGNALS:
      */
     void userCancelled(const QString &);
 
+    /*!
+     * Emitted by fetchMore() when more items are needed. The receiver is
+     * expected to add them with appendItems() and to update setCanFetchMore().
+     *
+     * \since 6.30
+     */
+    void fetchMoreRequested();
+
 protected:
     /*!
      * This calculates the size of the dropdown and the relative position of the top
@@ -219,6 +311,14 @@ protected:
      */
     bool eventFilter(QObject *, QEvent *) override;
 
+    /*!
+     * Reimplemented to recalculate the height of the rows when the font or the
+     * style changes.
+     *
+     * \since 6.30
+     */
+    void changeEvent(QEvent *event) override;
+
     /*!
      * The preferred global coordinate at which the completion box's top left corner
      * should be positioned.
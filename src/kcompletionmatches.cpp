@@ -82,6 +82,25 @@ QStringList KCompletionMatches::list(bool sort_P) const
     return stringList;
 }
 
+QStringList KCompletionMatches::topMatches(qsizetype limit, bool sort_P) const
+{
+    Q_D(const KCompletionMatches);
+    limit = std::clamp(limit, qsizetype(0), size());
+    QStringList stringList;
+    stringList.reserve(limit);
+    if (d->sorting && sort_P) {
+        const KCompletionMatchesList best = largest(limit);
+        std::transform(best.cbegin(), best.cend(), std::back_inserter(stringList), [](const KSortableItem<QString> &item) {
+            return item.value();
+        });
+    } else {
+        std::transform(crbegin(), crbegin() + limit, std::back_inserter(stringList), [](const KSortableItem<QString> &item) {
+            return item.value();
+        });
+    }
+    return stringList;
+}
+
 bool KCompletionMatches::sorting() const
 {
     Q_D(const KCompletionMatches);
@@ -79,6 +79,22 @@ public:
      * Returns the list of matches
      */
     QStringList list(bool sort = true) const;
+
+    /*!
+     * Returns at most the first \a limit matches as a QStringList.
+     *
+     * This is the same as list(sort).mid(0, limit), but only the returned
+     * matches are sorted, which is much cheaper when there are many matches.
+     * The matches themselves are not modified.
+     *
+     * \a limit the maximum number of matches to return
+     *
+     * \a sort if false, the matches won't be sorted before the conversion,
+     *             use only if you're sure the sorting is not needed
+     *
+     * \since 6.30
+     */
+    QStringList topMatches(qsizetype limit, bool sort = true) const;
     /*!
      * If sorting() returns \c false, the matches aren't sorted by their weight,
      * even if \c true is passed to list().
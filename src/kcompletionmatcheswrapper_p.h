@@ -9,10 +9,28 @@
 #define KCOMPLETIONMATCHESWRAPPER_P_H
 
 #include "kcompletion.h"
+#include "kcompletiontrace_p.h"
 #include "kcomptreenode_p.h"
 
 #include <kcompletionmatches.h>
 
+#include <QVarLengthArray>
+
+#include <vector>
+
+// A node whose siblings from node on are still to be visited by a depth first
+// traversal, prefixLength being the length of the string leading to them
+struct KCompTreeFrame {
+    const KCompTreeNode *node;
+    qsizetype prefixLength;
+};
+
+// The items below node, beginning being the string leading to node
+struct KCompTreeSubtree {
+    const KCompTreeNode *node;
+    QString beginning;
+};
+
 class KCOMPLETION_EXPORT KCompletionMatchesWrapper
 {
 public:
@@ -44,6 +62,22 @@ public:
         return m_compOrder;
     }
 
+    // If set, matches are taken from the pool instead of being rebuilt from the tree
+    void setItemPool(const KCompTreeItemPool *itemPool)
+    {
+        m_itemPool = itemPool;
+    }
+
+    // Takes over the matches of other, which must have the same sorting()
+    void assign(const KCompletionMatchesWrapper &other)
+    {
+        if (m_sortedListPtr && other.m_sortedListPtr) {
+            *m_sortedListPtr = *other.m_sortedListPtr;
+        }
+        m_stringList = other.m_stringList;
+        m_dirty = other.m_dirty;
+    }
+
     void append(int i, const QString &string)
     {
         if (m_sortedListPtr) {
@@ -78,7 +112,7 @@ public:
 
     QString first() const
     {
-        return list().constFirst();
+        return list(1).constFirst();
     }
 
     QString last() const
@@ -88,17 +122,85 @@ public:
 
     inline QStringList list() const;
 
+    // Returns the first limit matches of list()
+    inline QStringList list(qsizetype limit) const;
+
     inline void findAllCompletions(const KCompTreeNode *, const QString &, bool ignoreCase, bool &hasMultipleMatches);
 
     inline void extractStringsFromNode(const KCompTreeNode *, const QString &beginning, bool addWeight = false);
 
     inline void extractStringsFromNodeCI(const KCompTreeNode *, const QString &beginning, const QString &restString);
 
+    inline void extractItemsFromNode(const KCompTreeNode *);
+
+    // Appends to subtrees the nodes below node reached by restString, ignoring
+    // the case, in the order extractStringsFromNodeCI() extracts their items
+    static inline void findSubtreesCI(const KCompTreeNode *node, const QString &beginning, QStringView restString, QList<KCompTreeSubtree> &subtrees);
+
+    // Appends the matches of other, which must have the same sorting()
+    void appendMatches(const KCompletionMatchesWrapper &other)
+    {
+        if (other.isEmpty()) {
+            return;
+        }
+        if (m_sortedListPtr) {
+            *m_sortedListPtr += *other.m_sortedListPtr;
+        } else {
+            m_stringList += other.m_stringList;
+        }
+        m_dirty = true;
+    }
+
+    // Removes the matches for which keep returns false
+    template<typename Predicate>
+    void filter(Predicate keep)
+    {
+        if (m_sortedListPtr) {
+            m_sortedListPtr->removeIf([&keep](const KSortableItem<QString> &item) {
+                return !keep(item.value());
+            });
+        } else {
+            m_stringList.removeIf([&keep](const QString &string) {
+                return !keep(string);
+            });
+        }
+    }
+
     mutable QStringList m_stringList;
     std::unique_ptr<KCompletionMatchesList> m_sortedListPtr;
     mutable bool m_dirty;
     KCompletion::CompOrder m_compOrder;
     KCompletion::SorterFunction const &m_sorterFunction;
+    const KCompTreeItemPool *m_itemPool = nullptr;
+
+private:
+    // The extraction is compiled once for each order (Weighted) and for
+    // whether the weights are added to the strings (AddWeight). The public
+    // functions above pick the variant once per query, so the loops over
+    // the nodes don't need to check the order or the weighting.
+    template<bool Weighted>
+    void appendMatch(uint weight, const QString &string)
+    {
+        if constexpr (Weighted) {
+            m_sortedListPtr->insert(weight, string);
+        } else {
+            m_stringList.append(string);
+        }
+    }
+
+    template<bool Weighted, bool AddWeight>
+    void extractStrings(const KCompTreeNode *node, const QString &beginning);
+
+    template<bool Weighted>
+    void extractItems(const KCompTreeNode *node);
+
+    // Marks the matches for sorting if extraction added any to the previous count
+    void extracted(uint previousSize)
+    {
+        if (size() != previousSize) {
+            m_dirty = true;
+        }
+    }
 };
 
 void KCompletionMatchesWrapper::findAllCompletions(const KCompTreeNode *treeRoot, const QString &string, bool ignoreCase, bool &hasMultipleMatches)
@@ -115,27 +217,29 @@ void KCompletionMatchesWrapper::findAllCompletions(const KCompTreeNode *treeRoot
         return;
     }
 
-    QString completion;
     const KCompTreeNode *node = treeRoot;
 
     // start at the tree-root and try to find the search-string
+    qsizetype visited = 0;
     for (const QChar ch : string) {
         node = node->find(ch);
 
-        if (node) {
-            completion += ch;
-        } else {
+        if (!node) {
+            KCompletionTrace::addVisited(visited);
             return; // no completion -> return empty list
         }
+        ++visited;
     }
 
     // Now we have the last node of the to be completed string.
     // Follow it as long as it has exactly one child (= longest possible
     // completion)
 
+    QString completion = string;
     while (node->childrenCount() == 1) {
         node = node->firstChild();
-        if (!node->isNull()) {
+        ++visited;
+        if (!node->isNull() && !m_itemPool) {
             completion += *node;
         }
         // qDebug() << completion << node->latin1();
@@ -143,13 +247,15 @@ void KCompletionMatchesWrapper::findAllCompletions(const KCompTreeNode *treeRoot
 
     // there is just one single match)
     if (node->childrenCount() == 0) {
-        append(node->weight(), completion);
+        append(node->weight(), m_itemPool ? m_itemPool->value(node) : completion);
+        KCompletionTrace::addVisited(visited, 1);
     }
 
     else {
         // node has more than one child
         // -> recursively find all remaining completions
         hasMultipleMatches = true;
+        KCompletionTrace::addVisited(visited);
         extractStringsFromNode(node, completion);
     }
 }
@@ -157,6 +263,7 @@ void KCompletionMatchesWrapper::findAllCompletions(const KCompTreeNode *treeRoot
 QStringList KCompletionMatchesWrapper::list() const
 {
     if (m_sortedListPtr && m_dirty) {
+        KCompletionTrace::PhaseTimer sorting(KCompletionTrace::Sorting);
         m_sortedListPtr->sort();
         m_dirty = false;
 
@@ -166,72 +273,141 @@ QStringList KCompletionMatchesWrapper::list() const
         std::transform(m_sortedListPtr->crbegin(), m_sortedListPtr->crend(), std::back_inserter(m_stringList), [](const KSortableItem<QString> &item) {
             return item.value();
         });
-    } else if (m_compOrder == KCompletion::Sorted) {
+    } else if (m_dirty && m_compOrder == KCompletion::Sorted) {
+        KCompletionTrace::PhaseTimer sorting(KCompletionTrace::Sorting);
         m_sorterFunction(m_stringList);
+        m_dirty = false;
     }
 
     return m_stringList;
 }
 
+QStringList KCompletionMatchesWrapper::list(qsizetype limit) const
+{
+    if (m_sortedListPtr && m_dirty && limit < m_sortedListPtr->size()) {
+        // don't sort all matches when only the best ones are needed
+        KCompletionTrace::PhaseTimer sorting(KCompletionTrace::Sorting);
+        const KCompletionMatchesList best = m_sortedListPtr->largest(limit);
+        QStringList stringList;
+        stringList.reserve(best.size());
+        std::transform(best.cbegin(), best.cend(), std::back_inserter(stringList), [](const KSortableItem<QString> &item) {
+            return item.value();
+        });
+        return stringList;
+    }
+
+    return list().mid(0, limit);
+}
+
 void KCompletionMatchesWrapper::extractStringsFromNode(const KCompTreeNode *node, const QString &beginning, bool addWeight)
 {
     if (!node) {
         return;
     }
 
+    const uint previousSize = size();
+    if (m_itemPool && !addWeight) {
+        m_sortedListPtr ? extractItems<true>(node) : extractItems<false>(node);
+    } else if (m_sortedListPtr) {
+        addWeight ? extractStrings<true, true>(node, beginning) : extractStrings<true, false>(node, beginning);
+    } else {
+        addWeight ? extractStrings<false, true>(node, beginning) : extractStrings<false, false>(node, beginning);
+    }
+    extracted(previousSize);
+}
+
+void KCompletionMatchesWrapper::extractStringsFromNodeCI(const KCompTreeNode *node, const QString &beginning, const QString &restString)
+{
+    QList<KCompTreeSubtree> subtrees;
+    findSubtreesCI(node, beginning, restString, subtrees);
+    for (const KCompTreeSubtree &subtree : std::as_const(subtrees)) {
+        extractStringsFromNode(subtree.node, subtree.beginning, false /*noweight*/);
+    }
+}
+
+void KCompletionMatchesWrapper::extractItemsFromNode(const KCompTreeNode *node)
+{
+    const uint previousSize = size();
+    m_sortedListPtr ? extractItems<true>(node) : extractItems<false>(node);
+    extracted(previousSize);
+}
+
+template<bool Weighted, bool AddWeight>
+void KCompletionMatchesWrapper::extractStrings(const KCompTreeNode *node, const QString &beginning)
+{
     // qDebug() << "Beginning: " << beginning;
-    const KCompTreeChildren *list = node->children();
-    QString string;
+    // Depth first, without recursion: the siblings still to be visited are
+    // kept on a stack, and the characters are appended to and chopped off a
+    // single prefix buffer. Only a found match allocates its own string.
+    QVarLengthArray<KCompTreeFrame, 64> stack;
+    stack.append({node->firstChild(), beginning.size()});
+    QString prefix;
+    prefix.reserve(beginning.size() + 64);
+    prefix += beginning;
     QString w;
-
-    // loop thru all children
-    for (KCompTreeNode *cur = list->begin(); cur; cur = cur->m_next) {
-        string = beginning;
-        node = cur;
+    qsizetype visited = 0;
+    qsizetype found = 0;
+
+    while (!stack.isEmpty()) {
+        KCompTreeFrame &frame = stack.last();
+        node = frame.node;
+        if (!node) {
+            stack.removeLast();
+            continue;
+        }
+        frame.node = node->m_next;
+        prefix.truncate(frame.prefixLength);
+        ++visited;
         if (!node->isNull()) {
-            string += *node;
+            prefix += *node;
         }
 
-        while (node && node->childrenCount() == 1) {
+        while (node->childrenCount() == 1) {
             node = node->firstChild();
+            ++visited;
             if (node->isNull()) {
                 break;
             }
-            string += *node;
+            prefix += *node;
         }
 
-        if (node && node->isNull()) { // we found a leaf
-            if (addWeight) {
+        if (node->isNull()) { // we found a leaf
+            if constexpr (AddWeight) {
                 // add ":num" to the string to store the weighting
-                string += QLatin1Char(':');
+                prefix += QLatin1Char(':');
                 w.setNum(node->weight());
-                string.append(w);
+                prefix += w;
             }
-            append(node->weight(), string);
-        }
-
-        // recursively find all other strings.
-        if (node && node->childrenCount() > 1) {
-            extractStringsFromNode(node, string, addWeight);
+            // a deep copy, so that prefix keeps its buffer
+            appendMatch<Weighted>(node->weight(), QString(prefix.constData(), prefix.size()));
+            ++found;
+        } else if (node->childrenCount() > 1) {
+            // visit the children before the remaining siblings
+            stack.append({node->firstChild(), prefix.size()});
         }
     }
+    KCompletionTrace::addVisited(visited, found);
 }
 
-void KCompletionMatchesWrapper::extractStringsFromNodeCI(const KCompTreeNode *node, const QString &beginning, const QString &restString)
+void KCompletionMatchesWrapper::findSubtreesCI(const KCompTreeNode *node,
+                                               const QString &beginning,
+                                               QStringView restString,
+                                               QList<KCompTreeSubtree> &subtrees)
 {
     if (restString.isEmpty()) {
-        extractStringsFromNode(node, beginning, false /*noweight*/);
+        subtrees.append({node, beginning});
         return;
     }
 
     QChar ch1 = restString.at(0);
-    QString newRest = restString.mid(1);
+    QStringView newRest = restString.mid(1);
     KCompTreeNode *child1;
     KCompTreeNode *child2;
 
     child1 = node->find(ch1); // the correct match
     if (child1) {
-        extractStringsFromNodeCI(child1, beginning + QChar(*child1), newRest);
+        KCompletionTrace::addVisited(1);
+        findSubtreesCI(child1, beginning + QChar(*child1), newRest, subtrees);
     }
 
     // append the case insensitive matches, if available
@@ -244,10 +420,117 @@ void KCompletionMatchesWrapper::extractStringsFromNodeCI(const KCompTreeNode *no
         if (ch1 != ch2) {
             child2 = node->find(ch2);
             if (child2) {
-                extractStringsFromNodeCI(child2, beginning + QChar(*child2), newRest);
+                KCompletionTrace::addVisited(1);
+                findSubtreesCI(child2, beginning + QChar(*child2), newRest, subtrees);
             }
         }
     }
 }
 
+// Same traversal as extractStrings(), but the matches are the interned
+// items instead of strings built character by character
+template<bool Weighted>
+void KCompletionMatchesWrapper::extractItems(const KCompTreeNode *node)
+{
+    // the siblings still to be visited
+    QVarLengthArray<const KCompTreeNode *, 64> stack;
+    stack.append(node->firstChild());
+    qsizetype visited = 0;
+    qsizetype found = 0;
+
+    while (!stack.isEmpty()) {
+        node = stack.last();
+        if (!node) {
+            stack.removeLast();
+            continue;
+        }
+        stack.last() = node->m_next;
+        ++visited;
+        while (node->childrenCount() == 1) {
+            node = node->firstChild();
+            ++visited;
+        }
+
+        if (node->isNull()) { // we found a leaf
+            appendMatch<Weighted>(node->weight(), m_itemPool->value(node));
+            ++found;
+        } else if (node->childrenCount() > 1) {
+            stack.append(node->firstChild());
+        }
+    }
+    KCompletionTrace::addVisited(visited, found);
+}
+
+/*
+ * Visits the items below a node in the order of extractStringsFromNode(), but
+ * can stop after any number of items and resume later on. Its nodes must not
+ * be removed from the tree in the meantime.
+ */
+class KCompTreeItemWalker
+{
+public:
+    KCompTreeItemWalker(const KCompTreeNode *node, const QString &beginning, const KCompTreeItemPool *itemPool)
+        : m_prefix(beginning)
+        , m_itemPool(itemPool)
+    {
+        m_stack.push_back({node->firstChild(), beginning.size()});
+        dropVisitedFrames();
+    }
+
+    // Appends up to count further items to matches, returns the number of appended items
+    qsizetype next(KCompletionMatchesWrapper &matches, qsizetype count)
+    {
+        qsizetype found = 0;
+        qsizetype visited = 0;
+        while (found < count && !m_stack.empty()) {
+            KCompTreeFrame &frame = m_stack.back();
+            const KCompTreeNode *node = frame.node;
+            frame.node = node->m_next;
+            m_prefix.truncate(frame.prefixLength);
+            ++visited;
+
+            if (!node->isNull()) {
+                m_prefix += *node;
+            }
+            while (node->childrenCount() == 1) {
+                node = node->firstChild();
+                ++visited;
+                if (node->isNull()) {
+                    break;
+                }
+                m_prefix += *node;
+            }
+
+            if (node->isNull()) { // we found a leaf
+                matches.append(node->weight(), m_itemPool ? m_itemPool->value(node) : QString(m_prefix.constData(), m_prefix.size()));
+                ++found;
+            } else if (node->childrenCount() > 1) {
+                m_stack.push_back({node->firstChild(), m_prefix.size()});
+            }
+            dropVisitedFrames();
+        }
+        KCompletionTrace::addVisited(visited, found);
+        return found;
+    }
+
+    bool atEnd() const
+    {
+        return m_stack.empty();
+    }
+
+private:
+    // every subtree ends with an item, so a frame left after this holds at least one more
+    void dropVisitedFrames()
+    {
+        while (!m_stack.empty() && !m_stack.back().node) {
+            m_stack.pop_back();
+        }
+    }
+
+    std::vector<KCompTreeFrame> m_stack;
+    // the string leading to the node being visited, reused for all items
+    QString m_prefix;
+    const KCompTreeItemPool *m_itemPool;
+};
+
 #endif // KCOMPLETIONMATCHESWRAPPER_P_H
@@ -0,0 +1,60 @@
+/*
+    This file is part of the KDE libraries
+
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "kcompletionparallel_p.h"
+
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+int KCompletionParallel::threadCount(qsizetype taskCount)
+{
+    return int(std::clamp<qsizetype>(taskCount, 1, QThreadPool::globalInstance()->maxThreadCount()));
+}
+
+void KCompletionParallel::run(qsizetype taskCount, const std::function<void(qsizetype task, int thread)> &work)
+{
+    std::atomic<qsizetype> next{0};
+    const auto takeTasks = [&](int thread) {
+        for (qsizetype task = next++; task < taskCount; task = next++) {
+            work(task, thread);
+        }
+    };
+
+    // the helpers that didn't get to start until the calling thread ran out
+    // of tasks are taken back from the pool
+    QThreadPool *pool = QThreadPool::globalInstance();
+    const int helperCount = threadCount(taskCount) - 1;
+    QSemaphore helpersDone;
+    std::vector<std::unique_ptr<QRunnable>> helpers;
+    helpers.reserve(helperCount);
+    for (int i = 0; i < helperCount; ++i) {
+        QRunnable *helper = QRunnable::create([&takeTasks, &helpersDone, i]() {
+            takeTasks(i + 1);
+            helpersDone.release();
+        });
+        helper->setAutoDelete(false);
+        helpers.emplace_back(helper);
+        pool->start(helper);
+    }
+
+    takeTasks(0);
+
+    int runningHelpers = helperCount;
+    for (const auto &helper : helpers) {
+        if (pool->tryTake(helper.get())) {
+            --runningHelpers;
+        }
+    }
+    helpersDone.acquire(runningHelpers);
+}
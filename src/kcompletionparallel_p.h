@@ -0,0 +1,32 @@
+/*
+    This file is part of the KDE libraries
+
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KCOMPLETIONPARALLEL_P_H
+#define KCOMPLETIONPARALLEL_P_H
+
+#include <QtGlobal>
+
+#include <functional>
+
+/*
+ * Spreads work over the threads of QThreadPool::globalInstance(), see
+ * KCompletion::setParallelThreshold().
+ */
+namespace KCompletionParallel
+{
+// The number of threads run() uses for taskCount tasks
+int threadCount(qsizetype taskCount);
+
+// Calls work(task, thread) for every task from 0 to taskCount - 1, handing
+// out the tasks in this order, and returns once all calls are done. thread
+// is 0 for the calling thread, which works on the tasks as well, and
+// goes up to threadCount() - 1 for the threads of the pool.
+void run(qsizetype taskCount, const std::function<void(qsizetype task, int thread)> &work);
+}
+
+#endif // KCOMPLETIONPARALLEL_P_H
@@ -0,0 +1,142 @@
+/*
+    This file is part of the KDE libraries
+
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KCOMPLETIONTRACE_P_H
+#define KCOMPLETIONTRACE_P_H
+
+#include <kcompletiontrace_debug.h>
+
+#include <QElapsedTimer>
+#include <QString>
+
+#include <utility>
+
+class KCompletion;
+
+/*
+ * Records what answering a query of a KCompletion costs, and logs it on the
+ * kf.completion.trace category once the trace goes out of scope.
+ *
+ * Nothing is recorded unless debug output is enabled for that category, e.g.
+ * with QT_LOGGING_RULES="kf.completion.trace.debug=true", so a trace costs a
+ * single check otherwise.
+ *
+ * The tree traversal and the sorting report to the innermost trace of the
+ * current thread, see current().
+ */
+class KCompletionTrace
+{
+public:
+    enum Phase {
+        Sorting,
+        PostProcessing,
+        Delivery,
+        PhaseCount,
+    };
+
+    KCompletionTrace(const KCompletion *completion, const char *operation, const QString &string)
+        : m_enabled(KCOMPLETION_TRACE_LOG().isDebugEnabled())
+    {
+        if (m_enabled) {
+            m_completion = completion;
+            m_operation = operation;
+            m_prefixLength = string.size();
+            m_outer = std::exchange(s_current, this);
+            m_timer.start();
+        }
+    }
+
+    ~KCompletionTrace()
+    {
+        if (m_enabled) {
+            s_current = m_outer;
+            log();
+        }
+    }
+
+    KCompletionTrace(const KCompletionTrace &) = delete;
+    KCompletionTrace &operator=(const KCompletionTrace &) = delete;
+
+    // The trace of the query being answered in this thread, or nullptr if it isn't traced
+    static KCompletionTrace *current()
+    {
+        return s_current;
+    }
+
+    // Counts the tree nodes visited and the matches found for the current query
+    static void addVisited(qsizetype nodes, qsizetype matches = 0)
+    {
+        if (KCompletionTrace *trace = s_current) {
+            trace->m_visitedNodes += nodes;
+            trace->m_extractedMatches += matches;
+        }
+    }
+
+    // Marks the matches of the current query as taken from the result cache
+    static void setCached()
+    {
+        if (KCompletionTrace *trace = s_current) {
+            trace->m_cached = true;
+        }
+    }
+
+    // Sets the number of matches returned or delivered
+    void setResultCount(qsizetype count)
+    {
+        m_resultCount = count;
+    }
+
+    // Adds the time until it goes out of scope to a phase of the current query
+    class PhaseTimer
+    {
+    public:
+        explicit PhaseTimer(Phase phase)
+            : m_trace(s_current)
+            , m_phase(phase)
+        {
+            if (m_trace) {
+                m_timer.start();
+            }
+        }
+
+        ~PhaseTimer()
+        {
+            if (m_trace) {
+                m_trace->m_phaseNsecs[m_phase] += m_timer.nsecsElapsed();
+            }
+        }
+
+        PhaseTimer(const PhaseTimer &) = delete;
+        PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+    private:
+        KCompletionTrace *const m_trace;
+        const Phase m_phase;
+        QElapsedTimer m_timer;
+    };
+
+private:
+    void log() const;
+
+    static inline thread_local KCompletionTrace *s_current = nullptr;
+
+    const bool m_enabled;
+    bool m_cached = false;
+    const KCompletion *m_completion = nullptr;
+    const char *m_operation = nullptr;
+    // the query this one was started from, e.g. by a slot
+    KCompletionTrace *m_outer = nullptr;
+    qsizetype m_prefixLength = 0;
+    qsizetype m_visitedNodes = 0;
+    qsizetype m_extractedMatches = 0;
+    qsizetype m_resultCount = -1;
+    qint64 m_phaseNsecs[PhaseCount] = {};
+    QElapsedTimer m_timer;
+};
+
+#endif // KCOMPLETIONTRACE_P_H
@@ -0,0 +1,116 @@
+/*
+    This file is part of the KDE libraries
+
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "kcomptreenode_p.h"
+
+#include <QtAlgorithms>
+
+#if defined(Q_PROCESSOR_X86_64)
+#include <immintrin.h>
+#define KCOMPTREE_HAVE_SSE2 1
+// AVX2 is compiled in through a target attribute and picked at runtime
+#if defined(__GNUC__)
+#define KCOMPTREE_HAVE_AVX2 1
+#endif
+#endif
+
+namespace
+{
+thread_local KZoneAllocator *t_threadAllocator = nullptr;
+
+using FindKeyFunction = qsizetype (*)(const char16_t *, qsizetype, char16_t);
+
+qsizetype findKeyScalar(const char16_t *keys, qsizetype count, char16_t key)
+{
+    for (qsizetype i = 0; i < count; ++i) {
+        if (keys[i] == key) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Scans the keys from start on one at a time, for the rest that doesn't fill a vector
+qsizetype findKeyTail(const char16_t *keys, qsizetype start, qsizetype count, char16_t key)
+{
+    const qsizetype i = findKeyScalar(keys + start, count - start, key);
+    return i < 0 ? -1 : start + i;
+}
+
+#ifdef KCOMPTREE_HAVE_SSE2
+qsizetype findKeySse2(const char16_t *keys, qsizetype count, char16_t key)
+{
+    const __m128i needle = _mm_set1_epi16(short(key));
+    qsizetype i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + i));
+        // two bits per matching key
+        const uint mask = uint(_mm_movemask_epi8(_mm_cmpeq_epi16(chunk, needle)));
+        if (mask) {
+            return i + qCountTrailingZeroBits(mask) / 2;
+        }
+    }
+    return findKeyTail(keys, i, count, key);
+}
+#endif
+
+#ifdef KCOMPTREE_HAVE_AVX2
+__attribute__((target("avx2"))) qsizetype findKeyAvx2(const char16_t *keys, qsizetype count, char16_t key)
+{
+    const __m256i needle = _mm256_set1_epi16(short(key));
+    qsizetype i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i));
+        const uint mask = uint(_mm256_movemask_epi8(_mm256_cmpeq_epi16(chunk, needle)));
+        if (mask) {
+            return i + qCountTrailingZeroBits(mask) / 2;
+        }
+    }
+    if (i + 8 <= count) {
+        const qsizetype found = findKeySse2(keys + i, count - i, key);
+        return found < 0 ? -1 : i + found;
+    }
+    return findKeyTail(keys, i, count, key);
+}
+#endif
+
+// Set KCOMPLETION_NO_SIMD to compare against the scalar search
+FindKeyFunction selectFindKey()
+{
+    if (qEnvironmentVariableIsSet("KCOMPLETION_NO_SIMD")) {
+        return findKeyScalar;
+    }
+#ifdef KCOMPTREE_HAVE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return findKeyAvx2;
+    }
+#endif
+#ifdef KCOMPTREE_HAVE_SSE2
+    return findKeySse2;
+#else
+    return findKeyScalar;
+#endif
+}
+}
+
+qsizetype KCompTreeChildren::findKey(const char16_t *keys, qsizetype count, char16_t key)
+{
+    static const FindKeyFunction findKeyFunction = selectFindKey();
+    return findKeyFunction(keys, count, key);
+}
+
+void KCompTreeNode::setThreadAllocator(KZoneAllocator *allocator)
+{
+    t_threadAllocator = allocator;
+}
+
+KZoneAllocator *KCompTreeNode::threadAllocator()
+{
+    return t_threadAllocator;
+}
@@ -10,11 +10,33 @@
 
 #include "kcompletion_export.h"
 
+#include <QHash>
 #include <QSharedPointer>
+#include <QString>
 #include <kzoneallocator_p.h>
 
+#include <memory>
+#include <vector>
+
 class KCompTreeNode;
 
+/*
+ * Maps the 0x0 node terminating an item in the tree to the item itself,
+ * see KCompletion::setItemInterning()
+ */
+typedef QHash<const KCompTreeNode *, QString> KCompTreeItemPool;
+
+/*
+ * The characters of the children of a node, stored contiguously in the order
+ * of the list, so that KCompTreeChildren::find() can compare several of them
+ * at once. Only kept for nodes with many children, e.g. near the root of a
+ * tree of host names or hashes.
+ */
+struct KCompTreeChildIndex {
+    std::vector<char16_t> keys;
+    std::vector<KCompTreeNode *> nodes;
+};
+
 class KCOMPLETION_EXPORT KCompTreeChildren
 {
 public:
@@ -25,6 +47,9 @@ public:
     {
     }
 
+    KCompTreeChildren(const KCompTreeChildren &) = delete;
+    KCompTreeChildren &operator=(const KCompTreeChildren &) = delete;
+
     KCompTreeNode *begin() const
     {
         return m_first;
@@ -41,15 +66,34 @@ public:
     inline void insert(KCompTreeNode *after, KCompTreeNode *item);
     inline KCompTreeNode *remove(KCompTreeNode *item);
 
+    // Returns the child matching ch, or nullptr
+    inline KCompTreeNode *find(QChar ch) const;
+
+    // Drops the index, e.g. before removing all children one after the other
+    void dropIndex()
+    {
+        m_index.reset();
+    }
+
     uint count() const
     {
         return m_count;
     }
 
+    // Returns the position of the first key in keys, or -1. Compares 8 or
+    // 16 keys at once with SSE2 or AVX2, depending on what the CPU supports.
+    static qsizetype findKey(const char16_t *keys, qsizetype count, char16_t key);
+
+    // The number of children from which on they are indexed
+    static constexpr uint IndexThreshold = 8;
+
 private:
+    inline void buildIndex();
+
     KCompTreeNode *m_first;
     KCompTreeNode *m_last;
     uint m_count;
+    std::unique_ptr<KCompTreeChildIndex> m_index;
 };
 
 /*!
@@ -104,6 +148,7 @@ public:
     ~KCompTreeNode()
     {
         // delete all children
+        m_children.dropIndex();
         KCompTreeNode *cur = m_children.begin();
         while (cur) {
             KCompTreeNode *next = cur->m_next;
@@ -117,6 +162,9 @@ public:
 
     void *operator new(size_t s)
     {
+        if (KZoneAllocator *threadAlloc = threadAllocator()) {
+            return threadAlloc->allocate(s);
+        }
         Q_ASSERT(m_alloc);
         return m_alloc->allocate(s);
     }
@@ -124,6 +172,7 @@ public:
     void operator delete(void *s)
     {
         Q_ASSERT(m_alloc);
+        Q_ASSERT(!threadAllocator());
         m_alloc->deallocate(s);
     }
 
@@ -131,11 +180,7 @@ public:
     // Otherwise, returns 0L
     KCompTreeNode *find(const QChar &ch) const
     {
-        KCompTreeNode *cur = m_children.begin();
-        while (cur && (*cur != ch)) {
-            cur = cur->m_next;
-        }
-        return cur;
+        return m_children.find(ch);
     }
 
     // Adds a child-node "ch" to this node. If such a node is already existent,
@@ -204,6 +249,16 @@ public:
         return m_alloc;
     }
 
+    /*
+     * Makes the nodes created by the current thread come from allocator
+     * instead of allocator(), so that several threads can build subtrees at
+     * the same time. The blocks of allocator must be handed over to
+     * allocator() with KZoneAllocator::takeBlocks() before any of these
+     * nodes is deleted. nullptr switches back to allocator().
+     */
+    static void setThreadAllocator(KZoneAllocator *allocator);
+    static KZoneAllocator *threadAllocator();
+
 private:
     uint m_weight;
     KCompTreeChildren m_children;
@@ -279,6 +334,32 @@ void KCompTreeNode::remove(const QString &str)
     }
 }
 
+KCompTreeNode *KCompTreeChildren::find(QChar ch) const
+{
+    if (m_index) {
+        const qsizetype i = findKey(m_index->keys.data(), m_index->keys.size(), ch.unicode());
+        return i < 0 ? nullptr : m_index->nodes[i];
+    }
+
+    KCompTreeNode *cur = m_first;
+    while (cur && (*cur != ch)) {
+        cur = cur->m_next;
+    }
+    return cur;
+}
+
+// Builds the index from the list
+void KCompTreeChildren::buildIndex()
+{
+    m_index = std::make_unique<KCompTreeChildIndex>();
+    m_index->keys.reserve(m_count);
+    m_index->nodes.reserve(m_count);
+    for (KCompTreeNode *cur = m_first; cur; cur = cur->m_next) {
+        m_index->keys.push_back(cur->unicode());
+        m_index->nodes.push_back(cur);
+    }
+}
+
 KCompTreeNode *KCompTreeChildren::at(uint index) const
 {
     KCompTreeNode *cur = m_first;
@@ -300,6 +381,13 @@ void KCompTreeChildren::append(KCompTreeNode *item)
     m_last->m_next = item;
     item->m_next = nullptr;
     m_last = item;
+
+    if (m_index) {
+        m_index->keys.push_back(item->unicode());
+        m_index->nodes.push_back(item);
+    } else if (m_count >= IndexThreshold) {
+        buildIndex();
+    }
 }
 
 void KCompTreeChildren::prepend(KCompTreeNode *item)
@@ -313,6 +401,13 @@ void KCompTreeChildren::prepend(KCompTreeNode *item)
     }
     item->m_next = m_first;
     m_first = item;
+
+    if (m_index) {
+        m_index->keys.insert(m_index->keys.begin(), item->unicode());
+        m_index->nodes.insert(m_index->nodes.begin(), item);
+    } else if (m_count >= IndexThreshold) {
+        buildIndex();
+    }
 }
 
 void KCompTreeChildren::insert(KCompTreeNode *after, KCompTreeNode *item)
@@ -330,6 +425,14 @@ void KCompTreeChildren::insert(KCompTreeNode *after, KCompTreeNode *item)
     if (after == m_last) {
         m_last = item;
     }
+
+    if (m_index) {
+        const qsizetype i = findKey(m_index->keys.data(), m_index->keys.size(), after->unicode()) + 1;
+        m_index->keys.insert(m_index->keys.begin() + i, item->unicode());
+        m_index->nodes.insert(m_index->nodes.begin() + i, item);
+    } else if (m_count >= IndexThreshold) {
+        buildIndex();
+    }
 }
 
 KCompTreeNode *KCompTreeChildren::remove(KCompTreeNode *item)
@@ -355,6 +458,16 @@ KCompTreeNode *KCompTreeChildren::remove(KCompTreeNode *item)
         m_last = cur;
     }
     m_count--;
+
+    if (m_index) {
+        if (m_count < IndexThreshold) {
+            m_index.reset();
+        } else {
+            const qsizetype i = findKey(m_index->keys.data(), m_index->keys.size(), item->unicode());
+            m_index->keys.erase(m_index->keys.begin() + i);
+            m_index->nodes.erase(m_index->nodes.begin() + i);
+        }
+    }
     return item;
 }
 
@@ -16,7 +16,9 @@
 #include <QAbstractItemView>
 #include <QApplication>
 #include <QComboBox>
+#include <QHash>
 #include <QMenu>
+#include <QPointer>
 #include <QWheelEvent>
 
 class KHistoryComboBoxPrivate : public KComboBoxPrivate
@@ -49,6 +51,32 @@ public:
      */
     void _k_simulateActivated(const QString &);
 
+    /*
+     * Returns the number of items with the given text, without comparing
+     * it with all items
+     */
+    int itemCount(const QString &text);
+
+    /*
+     * Follows the changes of the model in itemCounts
+     */
+    void updateItemCounts();
+
+    /*
+     * Adds delta to the counts of the items in rows first to last
+     */
+    void countRows(const QModelIndex &parent, int first, int last, int delta);
+
+    /*
+     * Number of items per text, rebuilt from the model if itemCountsDirty.
+     * The rows themselves aren't indexed, they change with every item
+     * added to the top.
+     */
+    QHash<QString, int> itemCounts;
+    QPointer<QAbstractItemModel> countedModel;
+    QList<QMetaObject::Connection> countedModelConnections;
+    bool itemCountsDirty = true;
+
     /*
      * The text typed before Up or Down was pressed.
      */
@@ -68,6 +96,67 @@ public:
     std::function<QIcon(QString)> iconProvider;
 };
 
+int KHistoryComboBoxPrivate::itemCount(const QString &text)
+{
+    updateItemCounts();
+    return itemCounts.value(text);
+}
+
+void KHistoryComboBoxPrivate::updateItemCounts()
+{
+    Q_Q(KHistoryComboBox);
+    QAbstractItemModel *model = q->model();
+    if (model != countedModel) {
+        for (const QMetaObject::Connection &connection : std::as_const(countedModelConnections)) {
+            QObject::disconnect(connection);
+        }
+        countedModelConnections.clear();
+        countedModel = model;
+        itemCountsDirty = true;
+
+        if (model) {
+            countedModelConnections << QObject::connect(model, &QAbstractItemModel::rowsInserted, q, [this](const QModelIndex &parent, int first, int last) {
+                countRows(parent, first, last, 1);
+            });
+            countedModelConnections << QObject::connect(model, &QAbstractItemModel::rowsAboutToBeRemoved, q, [this](const QModelIndex &parent, int first, int last) {
+                countRows(parent, first, last, -1);
+            });
+            // the previous text of changed items is unknown, count all items again when needed
+            countedModelConnections << QObject::connect(model, &QAbstractItemModel::dataChanged, q, [this]() {
+                itemCountsDirty = true;
+            });
+            countedModelConnections << QObject::connect(model, &QAbstractItemModel::modelReset, q, [this]() {
+                itemCountsDirty = true;
+            });
+        }
+    }
+
+    if (itemCountsDirty) {
+        itemCounts.clear();
+        const int count = q->count();
+        for (int i = 0; i < count; ++i) {
+            ++itemCounts[q->itemText(i)];
+        }
+        itemCountsDirty = false;
+    }
+}
+
+void KHistoryComboBoxPrivate::countRows(const QModelIndex &parent, int first, int last, int delta)
+{
+    Q_Q(KHistoryComboBox);
+    if (itemCountsDirty || parent != q->rootModelIndex()) {
+        return;
+    }
+
+    for (int row = first; row <= last; ++row) {
+        int &count = itemCounts[q->itemText(row)];
+        count += delta;
+        if (count <= 0) {
+            itemCounts.remove(q->itemText(row));
+        }
+    }
+}
+
 void KHistoryComboBoxPrivate::init(bool useCompletion)
 {
     Q_Q(KHistoryComboBox);
@@ -217,15 +306,15 @@ void KHistoryComboBox::addToHistory(const QString &item)
     bool wasCurrent = false;
     // remove all existing items before adding
     if (!duplicatesEnabled()) {
-        int i = 0;
-        int itemCount = count();
-        while (i < itemCount) {
+        // usually there is none or a single one
+        int remaining = d->itemCount(item);
+        for (int i = 0; remaining > 0 && i < count();) {
             if (itemText(i) == item) {
                 if (!wasCurrent) {
                     wasCurrent = (i == currentIndex());
                 }
                 removeItem(i);
-                --itemCount;
+                --remaining;
             } else {
                 ++i;
             }
@@ -255,7 +344,7 @@ void KHistoryComboBox::addToHistory(const QString &item)
         // anymore available at all in the combobox.
         const QString rmItem = itemText(rmIndex);
         removeItem(rmIndex);
-        if (useComp && !contains(rmItem)) {
+        if (useComp && !d->itemCount(rmItem)) {
             completionObject()->removeItem(rmItem);
         }
     }
@@ -267,30 +356,28 @@ void KHistoryComboBox::addToHistory(const QString &item)
 
 bool KHistoryComboBox::removeFromHistory(const QString &item)
 {
-    if (item.isEmpty()) {
+    Q_D(KHistoryComboBox);
+    if (item.isEmpty() || !d->itemCount(item)) {
         return false;
     }
 
-    bool removed = false;
     const QString temp = currentText();
-    int i = 0;
-    int itemCount = count();
-    while (i < itemCount) {
+    int remaining = d->itemCount(item);
+    for (int i = 0; remaining > 0 && i < count();) {
         if (item == itemText(i)) {
-            removed = true;
             removeItem(i);
-            --itemCount;
+            --remaining;
         } else {
             ++i;
         }
     }
 
-    if (removed && useCompletion()) {
+    if (useCompletion()) {
         completionObject()->removeItem(item);
     }
 
     setEditText(temp);
-    return removed;
+    return true;
 }
 
 // going up in the history, rotating when reaching QListBox::count()
@@ -438,7 +525,7 @@ void KHistoryComboBoxPrivate::_k_simulateActivated(const QString &text)
        Qt doesn't emit activated on typed text if the item is not already there,
        which is perhaps reasonable. Generate the signal ourselves if that's the case.
     */
-    if ((q->insertPolicy() == q->NoInsert && q->findText(text, Qt::MatchFixedString | Qt::MatchCaseSensitive) == -1)) {
+    if ((q->insertPolicy() == q->NoInsert && !itemCount(text))) {
         Q_EMIT q->textActivated(text);
     }
 
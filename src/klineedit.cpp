@@ -60,6 +60,87 @@ void KLineEditPrivate::updateUserText(const QString &text)
     }
 }
 
+void KLineEditPrivate::requestCompletion(const QString &text)
+{
+    Q_Q(KLineEdit);
+    if (completionDelay <= 0) {
+        q->doCompletion(text);
+        return;
+    }
+
+    if (completionTimer && completionTimer->isActive()) {
+        pendingCompletionText = text;
+        pendingAutoSuggest = autoSuggest;
+        completionPending = true;
+        return;
+    }
+
+    if (!completionTimer) {
+        completionTimer = new QTimer(q);
+        completionTimer->setSingleShot(true);
+        q->connect(completionTimer, &QTimer::timeout, q, [this]() {
+            completePendingText();
+        });
+    }
+    completionTimer->start(completionDelay);
+    q->doCompletion(text);
+}
+
+void KLineEditPrivate::completePendingText()
+{
+    Q_Q(KLineEdit);
+    if (!completionPending) {
+        return;
+    }
+
+    const QString text = pendingCompletionText;
+    cancelPendingCompletion();
+
+    // the further changes during this completion are coalesced again
+    completionTimer->start(completionDelay);
+
+    KCompletion *comp = q->compObj();
+    if (comp && q->handleSignals() && comp->matchChunkSize() <= 0) {
+        // the completion object might be shared with other widgets, let it
+        // drop this request if it gets superseded and serve the focused one
+        // first. The completion itself is done once it is our turn.
+        requestAutoSuggest = pendingAutoSuggest;
+        comp->requestCompletion(q, text);
+        return;
+    }
+
+    const bool wasAutoSuggest = autoSuggest;
+    autoSuggest = pendingAutoSuggest;
+    q->doCompletion(text);
+    autoSuggest = wasAutoSuggest;
+}
+
+void KLineEditPrivate::cancelPendingCompletion()
+{
+    Q_Q(KLineEdit);
+    completionPending = false;
+    pendingCompletionText.clear();
+    if (KCompletion *comp = q->compObj()) {
+        comp->cancelCompletionRequest(q);
+    }
+}
+
+void KLineEditPrivate::completeRequestedText(const QString &text)
+{
+    Q_Q(KLineEdit);
+    const KCompletion::CompletionMode mode = q->completionMode();
+    if (mode != KCompletion::CompletionPopup && mode != KCompletion::CompletionPopupAuto) {
+        return;
+    }
+
+    // through makeCompletion(), so that overrides of it see the text and
+    // KCompletion rotates through its matches
+    const bool wasAutoSuggest = autoSuggest;
+    autoSuggest = requestAutoSuggest;
+    q->doCompletion(text);
+    autoSuggest = wasAutoSuggest;
+}
+
 bool KLineEditPrivate::s_backspacePerformsCompletion = false;
 bool KLineEditPrivate::s_initialized = false;
 
@@ -77,6 +158,11 @@ void KLineEditPrivate::init()
     enableSqueezedText = false;
 
     completionRunning = false;
+    streamingMatches = false;
+    completionPending = false;
+    pendingAutoSuggest = false;
+    requestAutoSuggest = false;
+    keyActionsDirty = true;
     if (!s_initialized) {
         KConfigGroup config(KSharedConfig::openConfig(), QStringLiteral("General"));
         s_backspacePerformsCompletion = config.readEntry("Backspace performs completion", false);
@@ -123,6 +209,58 @@ void KLineEditPrivate::init()
     q->connect(q, &KLineEdit::textChanged, q, [this](const QString &text) {
         _k_textChanged(text);
     });
+
+    q->connect(KStandardShortcut::shortcutWatcher(), &KStandardShortcut::StandardShortcutWatcher::shortcutChanged, q, [this]() {
+        keyActionsDirty = true;
+    });
+}
+
+uint KLineEditPrivate::keyActions(int key)
+{
+    Q_Q(KLineEdit);
+    // cheap if unchanged, the maps share their data then
+    const KLineEdit::KeyBindingMap keyBindings = q->keyBindingMap();
+    if (keyActionsDirty || keyBindings != keyActionBindings) {
+        updateKeyActions(keyBindings);
+    }
+    return keyActionTable.value(key);
+}
+
+void KLineEditPrivate::updateKeyActions(const KLineEdit::KeyBindingMap &keyBindings)
+{
+    keyActionTable.clear();
+    const auto addAction = [this](const QList<QKeySequence> &sequences, KeyAction action) {
+        for (const QKeySequence &sequence : sequences) {
+            // a key press only ever matches single key sequences
+            if (sequence.count() == 1) {
+                keyActionTable[sequence[0].toCombined()] |= action;
+            }
+        }
+    };
+    const auto binding = [&keyBindings](KLineEdit::KeyBindingType type, KStandardShortcut::StandardShortcut id) {
+        const QList<QKeySequence> sequences = keyBindings.value(type);
+        return sequences.isEmpty() ? KStandardShortcut::shortcut(id) : sequences;
+    };
+
+    addAction(KStandardShortcut::copy(), CopyAction);
+    addAction(KStandardShortcut::paste(), PasteAction);
+    addAction(KStandardShortcut::pasteSelection(), PasteSelectionAction);
+    addAction(KStandardShortcut::cut(), CutAction);
+    addAction(KStandardShortcut::undo(), UndoAction);
+    addAction(KStandardShortcut::redo(), RedoAction);
+    addAction(KStandardShortcut::deleteWordBack(), DeleteWordBackAction);
+    addAction(KStandardShortcut::deleteWordForward(), DeleteWordForwardAction);
+    addAction(KStandardShortcut::backwardWord(), BackwardWordAction);
+    addAction(KStandardShortcut::forwardWord(), ForwardWordAction);
+    addAction(KStandardShortcut::beginningOfLine(), BeginningOfLineAction);
+    addAction(KStandardShortcut::endOfLine(), EndOfLineAction);
+    addAction(binding(KLineEdit::TextCompletion, KStandardShortcut::TextCompletion), TextCompletionAction);
+    addAction(binding(KLineEdit::PrevCompletionMatch, KStandardShortcut::PrevCompletion), PrevCompletionMatchAction);
+    addAction(binding(KLineEdit::NextCompletionMatch, KStandardShortcut::NextCompletion), NextCompletionMatchAction);
+    addAction(binding(KLineEdit::SubstringCompletion, KStandardShortcut::SubstringCompletion), SubstringCompletionAction);
+
+    keyActionBindings = keyBindings;
+    keyActionsDirty = false;
 }
 
 KLineEdit::KLineEdit(const QString &string, QWidget *parent)
@@ -172,6 +310,7 @@ void KLineEdit::setCompletionMode(KCompletion::CompletionMode mode)
         && d->completionBox && d->completionBox->isVisible()) {
         d->completionBox->hide();
     }
+    d->cancelPendingCompletion();
 
     // If the widgets echo mode is not Normal, no completion
     // feature will be enabled even if one is requested.
@@ -263,11 +402,21 @@ void KLineEdit::makeCompletion(const QString &text)
     const QString match = comp->makeCompletion(text);
 
     if (mode == KCompletion::CompletionPopup || mode == KCompletion::CompletionPopupAuto) {
+        d->streamingMatches = false;
         if (match.isEmpty()) {
             if (d->completionBox) {
                 d->completionBox->hide();
                 d->completionBox->clear();
             }
+        } else if (comp->matchChunkSize() > 0) {
+            // show the first matches right away, the others are appended
+            // when KCompletion delivers them
+            setCompletedItems(comp->streamMatches(text), comp->shouldAutoSuggest());
+            d->streamingMatches = comp->hasMoreMatches();
+            if (d->completionBox) {
+                // let the box ask for the next matches when they are scrolled into view
+                d->completionBox->setCanFetchMore(d->streamingMatches && comp->fetchMatchesOnDemand());
+            }
         } else {
             setCompletedItems(comp->allMatches(), comp->shouldAutoSuggest());
         }
@@ -345,58 +494,58 @@ void KLineEdit::setText(const QString &text)
     QLineEdit::setText(text);
 }
 
+// Returns how many letters of text fit on each side of ellipsis into width, at most half of them
+static int squeezedLetters(const QFontMetrics &fm, QStringView text, const QString &ellipsis, int width)
+{
+    int low = 0;
+    int high = text.length() / 2;
+    while (low < high) {
+        const int letters = (low + high + 1) / 2;
+        if (fm.boundingRect(text.left(letters) + ellipsis + text.right(letters)).width() <= width) {
+            low = letters;
+        } else {
+            high = letters - 1;
+        }
+    }
+    return low;
+}
+
 void KLineEditPrivate::setSqueezedText()
 {
     Q_Q(KLineEdit);
     squeezedStart = 0;
     squeezedEnd = 0;
     const QString fullText = squeezedText;
-    const int fullLength = fullText.length();
     const QFontMetrics fm(q->fontMetrics());
     const int labelWidth = q->size().width() - 2 * q->style()->pixelMetric(QStyle::PM_DefaultFrameWidth) - 2;
-    const int textWidth = fm.boundingRect(fullText).width();
+    // TODO: better would be "…" char (0x2026), but for that one would need to ensure it's from the main font,
+    // otherwise if resulting in use of a new fallback font this can affect the metrics of the complete text,
+    // resulting in shifted characters
+    const QString ellipsisText = QStringLiteral("...");
+
+    // resizing only needs to measure the squeezed text again
+    if (fullText != squeezeCache.text || q->font() != squeezeCache.font) {
+        squeezeCache.text = fullText;
+        squeezeCache.font = q->font();
+        squeezeCache.textWidth = fm.boundingRect(fullText).width();
+        squeezeCache.labelWidth = -1;
+    }
+    const int textWidth = squeezeCache.textWidth;
 
     // TODO: investigate use of QFontMetrics::elidedText for this
     if (textWidth > labelWidth) {
-        const QStringView sview{fullText};
-        // TODO: better would be "…" char (0x2026), but for that one would need to ensure it's from the main font,
-        // otherwise if resulting in use of a new fallback font this can affect the metrics of the complete text,
-        // resulting in shifted characters
-        const QString ellipsisText = QStringLiteral("...");
-        // start with the dots only
-        QString squeezedText = ellipsisText;
-        int squeezedWidth = fm.boundingRect(squeezedText).width();
-
-        // estimate how many letters we can add to the dots on both sides
-        int letters = fullText.length() * (labelWidth - squeezedWidth) / textWidth / 2;
-        squeezedText = sview.left(letters) + ellipsisText + sview.right(letters);
-        squeezedWidth = fm.boundingRect(squeezedText).width();
-
-        if (squeezedWidth < labelWidth) {
-            // we estimated too short
-            // add letters while text < label
-            do {
-                letters++;
-                squeezedText = sview.left(letters) + ellipsisText + sview.right(letters);
-                squeezedWidth = fm.boundingRect(squeezedText).width();
-            } while (squeezedWidth < labelWidth && letters <= fullLength / 2);
-            letters--;
-            squeezedText = sview.left(letters) + ellipsisText + sview.right(letters);
-        } else if (squeezedWidth > labelWidth) {
-            // we estimated too long
-            // remove letters while text > label
-            do {
-                letters--;
-                squeezedText = sview.left(letters) + ellipsisText + sview.right(letters);
-                squeezedWidth = fm.boundingRect(squeezedText).width();
-            } while (squeezedWidth > labelWidth && letters >= 5);
+        if (labelWidth != squeezeCache.labelWidth) {
+            squeezeCache.labelWidth = labelWidth;
+            squeezeCache.letters = squeezedLetters(fm, fullText, ellipsisText, labelWidth);
         }
+        const int letters = squeezeCache.letters;
 
         if (letters < 5) {
-            // too few letters added -> we give up squeezing
+            // too few letters fit -> we give up squeezing
             q->QLineEdit::setText(fullText);
         } else {
-            q->QLineEdit::setText(squeezedText);
+            const QStringView sview{fullText};
+            q->QLineEdit::setText(sview.left(letters) + ellipsisText + sview.right(letters));
             squeezedStart = letters;
             squeezedEnd = fullText.length() - letters;
         }
@@ -466,11 +615,12 @@ void KLineEdit::keyPressEvent(QKeyEvent *e)
 {
     Q_D(KLineEdit);
     const int key = e->key() | e->modifiers();
+    const uint actions = d->keyActions(key);
 
-    if (KStandardShortcut::copy().contains(key)) {
+    if (actions & KLineEditPrivate::CopyAction) {
         copy();
         return;
-    } else if (KStandardShortcut::paste().contains(key)) {
+    } else if (actions & KLineEditPrivate::PasteAction) {
         // TODO:
         // we should restore the original text (not autocompleted), otherwise the paste
         // will get into troubles Bug: 134691
@@ -478,27 +628,27 @@ void KLineEdit::keyPressEvent(QKeyEvent *e)
             paste();
         }
         return;
-    } else if (KStandardShortcut::pasteSelection().contains(key)) {
+    } else if (actions & KLineEditPrivate::PasteSelectionAction) {
         QString text = QApplication::clipboard()->text(QClipboard::Selection);
         insert(text);
         deselect();
         return;
-    } else if (KStandardShortcut::cut().contains(key)) {
+    } else if (actions & KLineEditPrivate::CutAction) {
         if (!isReadOnly()) {
             cut();
         }
         return;
-    } else if (KStandardShortcut::undo().contains(key)) {
+    } else if (actions & KLineEditPrivate::UndoAction) {
         if (!isReadOnly()) {
             undo();
         }
         return;
-    } else if (KStandardShortcut::redo().contains(key)) {
+    } else if (actions & KLineEditPrivate::RedoAction) {
         if (!isReadOnly()) {
             redo();
         }
         return;
-    } else if (KStandardShortcut::deleteWordBack().contains(key)) {
+    } else if (actions & KLineEditPrivate::DeleteWordBackAction) {
         cursorWordBackward(true);
         if (hasSelectedText() && !isReadOnly()) {
             del();
@@ -506,7 +656,7 @@ void KLineEdit::keyPressEvent(QKeyEvent *e)
 
         e->accept();
         return;
-    } else if (KStandardShortcut::deleteWordForward().contains(key)) {
+    } else if (actions & KLineEditPrivate::DeleteWordForwardAction) {
         // Workaround for QT bug where
         cursorWordForward(true);
         if (hasSelectedText() && !isReadOnly()) {
@@ -515,19 +665,19 @@ void KLineEdit::keyPressEvent(QKeyEvent *e)
 
         e->accept();
         return;
-    } else if (KStandardShortcut::backwardWord().contains(key)) {
+    } else if (actions & KLineEditPrivate::BackwardWordAction) {
         cursorWordBackward(false);
         e->accept();
         return;
-    } else if (KStandardShortcut::forwardWord().contains(key)) {
+    } else if (actions & KLineEditPrivate::ForwardWordAction) {
         cursorWordForward(false);
         e->accept();
         return;
-    } else if (KStandardShortcut::beginningOfLine().contains(key)) {
+    } else if (actions & KLineEditPrivate::BeginningOfLineAction) {
         home(false);
         e->accept();
         return;
-    } else if (KStandardShortcut::endOfLine().contains(key)) {
+    } else if (actions & KLineEditPrivate::EndOfLineAction) {
         end(false);
         e->accept();
         return;
@@ -560,7 +710,6 @@ void KLineEdit::keyPressEvent(QKeyEvent *e)
             }
         }
 
-        const KeyBindingMap keys = keyBindingMap();
         const KCompletion::CompletionMode mode = completionMode();
         const bool noModifier = (e->modifiers() == Qt::NoButton //
                                  || e->modifiers() == Qt::ShiftModifier //
@@ -724,7 +873,7 @@ void KLineEdit::keyPressEvent(QKeyEvent *e)
                     d->completionBox->setCancelledText(txt);
                 }
 
-                doCompletion(txt);
+                d->requestCompletion(txt);
 
                 if ((e->key() == Qt::Key_Backspace || e->key() == Qt::Key_Delete) //
                     && mode == KCompletion::CompletionPopupAuto) {
@@ -733,20 +882,14 @@ void KLineEdit::keyPressEvent(QKeyEvent *e)
 
                 e->accept();
             } else if (!len && d->completionBox && d->completionBox->isVisible()) {
+                d->cancelPendingCompletion();
                 d->completionBox->hide();
             }
 
             return;
         } else if (mode == KCompletion::CompletionShell) {
             // Handles completion.
-            QList<QKeySequence> cut;
-            if (keys[TextCompletion].isEmpty()) {
-                cut = KStandardShortcut::shortcut(KStandardShortcut::TextCompletion);
-            } else {
-                cut = keys[TextCompletion];
-            }
-
-            if (cut.contains(key)) {
+            if (actions & KLineEditPrivate::TextCompletionAction) {
                 // Emit completion if the completion mode is CompletionShell
                 // and the cursor is at the end of the string.
                 const QString txt = text();
@@ -762,14 +905,7 @@ void KLineEdit::keyPressEvent(QKeyEvent *e)
 
         // handle rotation
         // Handles previous match
-        QList<QKeySequence> cut;
-        if (keys[PrevCompletionMatch].isEmpty()) {
-            cut = KStandardShortcut::shortcut(KStandardShortcut::PrevCompletion);
-        } else {
-            cut = keys[PrevCompletionMatch];
-        }
-
-        if (cut.contains(key)) {
+        if (actions & KLineEditPrivate::PrevCompletionMatchAction) {
             if (emitSignals()) {
                 Q_EMIT textRotation(KCompletionBase::PrevCompletionMatch);
             }
@@ -780,13 +916,7 @@ void KLineEdit::keyPressEvent(QKeyEvent *e)
         }
 
         // Handles next match
-        if (keys[NextCompletionMatch].isEmpty()) {
-            cut = KStandardShortcut::shortcut(KStandardShortcut::NextCompletion);
-        } else {
-            cut = keys[NextCompletionMatch];
-        }
-
-        if (cut.contains(key)) {
+        if (actions & KLineEditPrivate::NextCompletionMatchAction) {
             if (emitSignals()) {
                 Q_EMIT textRotation(KCompletionBase::NextCompletionMatch);
             }
@@ -798,14 +928,7 @@ void KLineEdit::keyPressEvent(QKeyEvent *e)
 
         // substring completion
         if (compObj()) {
-            QList<QKeySequence> cut;
-            if (keys[SubstringCompletion].isEmpty()) {
-                cut = KStandardShortcut::shortcut(KStandardShortcut::SubstringCompletion);
-            } else {
-                cut = keys[SubstringCompletion];
-            }
-
-            if (cut.contains(key)) {
+            if (actions & KLineEditPrivate::SubstringCompletionAction) {
                 if (emitSignals()) {
                     Q_EMIT substringCompletion(text());
                 }
@@ -1068,6 +1191,24 @@ bool KLineEdit::trapReturnKey() const
     return d->trapReturnKeyEvents;
 }
 
+void KLineEdit::setCompletionDelay(int msec)
+{
+    Q_D(KLineEdit);
+    d->completionDelay = msec;
+    if (msec <= 0) {
+        d->cancelPendingCompletion();
+        if (d->completionTimer) {
+            d->completionTimer->stop();
+        }
+    }
+}
+
+int KLineEdit::completionDelay() const
+{
+    Q_D(const KLineEdit);
+    return d->completionDelay;
+}
+
 void KLineEdit::setUrl(const QUrl &url)
 {
     setText(url.toDisplayString());
@@ -1090,6 +1231,16 @@ void KLineEdit::setCompletionBox(KCompletionBox *box)
 
         connect(d->completionBox, &KCompletionBox::textActivated, this, &KLineEdit::completionBoxActivated);
         connect(d->completionBox, &KCompletionBox::textActivated, this, &KLineEdit::textEdited);
+        connect(d->completionBox, &KCompletionBox::textActivated, this, [d]() {
+            d->cancelPendingCompletion();
+        });
+
+        connect(d->completionBox, &KCompletionBox::fetchMoreRequested, this, [this]() {
+            Q_D(KLineEdit);
+            if (d->streamingMatches && compObj()) {
+                compObj()->fetchMoreMatches();
+            }
+        });
     }
 }
 
@@ -1111,6 +1262,7 @@ static void setEditText(KLineEdit *edit, const QString &text)
 void KLineEdit::userCancelled(const QString &cancelText)
 {
     Q_D(KLineEdit);
+    d->cancelPendingCompletion();
     if (completionMode() != KCompletion::CompletionPopupAuto) {
         setEditText(this, cancelText);
     } else if (hasSelectedText()) {
@@ -1129,73 +1281,23 @@ void KLineEdit::userCancelled(const QString &cancelText)
 
 bool KLineEditPrivate::overrideShortcut(const QKeyEvent *e)
 {
-    Q_Q(KLineEdit);
-    QList<QKeySequence> scKey;
-
     const int key = e->key() | e->modifiers();
-    const KLineEdit::KeyBindingMap keys = q->keyBindingMap();
-
-    if (keys[KLineEdit::TextCompletion].isEmpty()) {
-        scKey = KStandardShortcut::shortcut(KStandardShortcut::TextCompletion);
-    } else {
-        scKey = keys[KLineEdit::TextCompletion];
-    }
-
-    if (scKey.contains(key)) {
-        return true;
-    }
-
-    if (keys[KLineEdit::NextCompletionMatch].isEmpty()) {
-        scKey = KStandardShortcut::shortcut(KStandardShortcut::NextCompletion);
-    } else {
-        scKey = keys[KLineEdit::NextCompletionMatch];
-    }
-
-    if (scKey.contains(key)) {
-        return true;
-    }
-
-    if (keys[KLineEdit::PrevCompletionMatch].isEmpty()) {
-        scKey = KStandardShortcut::shortcut(KStandardShortcut::PrevCompletion);
-    } else {
-        scKey = keys[KLineEdit::PrevCompletionMatch];
-    }
-
-    if (scKey.contains(key)) {
-        return true;
-    }
+    const uint actions = keyActions(key);
 
     constexpr int ctrlE = QKeyCombination(Qt::CTRL | Qt::Key_E).toCombined();
     constexpr int ctrlU = QKeyCombination(Qt::CTRL | Qt::Key_U).toCombined();
 
-    // Override all the text manupilation accelerators...
-    if (KStandardShortcut::copy().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::paste().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::cut().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::undo().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::redo().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::deleteWordBack().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::deleteWordForward().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::forwardWord().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::backwardWord().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::beginningOfLine().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::endOfLine().contains(key)) {
+    // Override the completion and all the text manupilation accelerators...
+    constexpr uint overriddenActions = TextCompletionAction | NextCompletionMatchAction | PrevCompletionMatchAction | CopyAction | PasteAction | CutAction
+        | UndoAction | RedoAction | DeleteWordBackAction | DeleteWordForwardAction | ForwardWordAction | BackwardWordAction | BeginningOfLineAction
+        | EndOfLineAction;
+    if (actions & overriddenActions) {
         return true;
     }
 
     // Shortcut overrides for shortcuts that QLineEdit handles
     // but doesn't dare force as "stronger than kaction shortcuts"...
-    else if (e->matches(QKeySequence::SelectAll)) {
+    if (e->matches(QKeySequence::SelectAll)) {
         return true;
     } else if (qApp->platformName() == QLatin1String("xcb") && (key == ctrlE || key == ctrlU)) {
         return true;
@@ -1231,25 +1333,8 @@ void KLineEdit::setCompletedItems(const QStringList &items, bool autoSuggest)
         completionBox();
 
         if (d->completionBox->isVisible()) {
-            QListWidgetItem *currentItem = d->completionBox->currentItem();
-
-            QString currentSelection;
-            if (currentItem != nullptr) {
-                currentSelection = currentItem->text();
-            }
-
+            // keeps the selected item if it is still there
             d->completionBox->setItems(items);
-
-            const QList<QListWidgetItem *> matchedItems = d->completionBox->findItems(currentSelection, Qt::MatchExactly);
-            QListWidgetItem *matchedItem = matchedItems.isEmpty() ? nullptr : matchedItems.first();
-
-            if (matchedItem) {
-                const bool blocked = d->completionBox->blockSignals(true);
-                d->completionBox->setCurrentItem(matchedItem);
-                d->completionBox->blockSignals(blocked);
-            } else {
-                d->completionBox->setCurrentRow(-1);
-            }
         } else { // completion box not visible yet -> show it
             if (!txt.isEmpty()) {
                 d->completionBox->setCancelledText(txt);
@@ -1290,12 +1375,33 @@ void KLineEdit::setCompletionObject(KCompletion *comp, bool handle)
     KCompletion *oldComp = compObj();
     if (oldComp && handleSignals()) {
         disconnect(d->m_matchesConnection);
+        disconnect(d->m_moreMatchesConnection);
+        disconnect(d->m_completionReadyConnection);
     }
+    if (oldComp) {
+        oldComp->cancelCompletionRequest(this);
+    }
+    d->streamingMatches = false;
 
     if (comp && handle) {
         d->m_matchesConnection = connect(comp, &KCompletion::matches, this, [this](const QStringList &list) {
             setCompletedItems(list);
         });
+        d->m_moreMatchesConnection = connect(comp, &KCompletion::moreMatches, this, [this](const QStringList &chunk) {
+            Q_D(KLineEdit);
+            if (d->streamingMatches && d->completionBox && d->completionBox->isVisible()) {
+                d->completionBox->appendItems(chunk);
+                d->streamingMatches = compObj()->hasMoreMatches();
+                d->completionBox->setCanFetchMore(d->streamingMatches && compObj()->fetchMatchesOnDemand());
+            }
+        });
+        d->m_completionReadyConnection =
+            connect(comp, &KCompletion::completionReady, this, [this](QObject *requester, const QString &string) {
+                Q_D(KLineEdit);
+                if (requester == this) {
+                    d->completeRequestedText(string);
+                }
+            });
     }
 
     KCompletionBase::setCompletionObject(comp, handle);
@@ -219,6 +219,35 @@ public:
      */
     bool trapReturnKey() const;
 
+    /*!
+     * Sets the minimum interval between two completions in the popup completion
+     * modes to \a msec milliseconds.
+     *
+     * The first change of the text is completed right away. Further changes
+     * within the interval are coalesced and only the last one is completed,
+     * once the interval is over. This avoids updating the popup for every
+     * single character when typing fast. The other completion modes insert
+     * the completion into the text and are never delayed.
+     *
+     * Delayed completions are done through makeCompletion() and announced
+     * via completion() like the others, once the completion object gets to
+     * them, see KCompletion::requestCompletion().
+     *
+     * The default is 0, every change is completed right away.
+     *
+     * \since 6.30
+     * \sa completionDelay()
+     */
+    void setCompletionDelay(int msec);
+
+    /*!
+     * Returns the minimum interval between two completions in milliseconds.
+     *
+     * \since 6.30
+     * \sa setCompletionDelay()
+     */
+    int completionDelay() const;
+
     /*!
      * This method will create a completion-box if none is there, yet.
      *
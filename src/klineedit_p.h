@@ -11,8 +11,11 @@
 
 #include "klineedit.h"
 
+#include <QHash>
+
 class KCompletionBox;
 class KLineEditUrlDropEventFilter;
+class QTimer;
 
 class KLineEditPrivate
 {
@@ -32,6 +35,13 @@ public:
 
     void updateUserText(const QString &text);
 
+    // Completes text, or later on if the last completion is less than completionDelay ago
+    void requestCompletion(const QString &text);
+    void completePendingText();
+    void cancelPendingCompletion();
+    // Completes text once KCompletion::requestCompletion() got to it
+    void completeRequestedText(const QString &text);
+
     /*!
      * Checks whether we should/should not consume a key used as a shortcut.
      * This makes it possible to handle shortcuts in the focused widget before any
@@ -39,6 +49,30 @@ public:
      */
     bool overrideShortcut(const QKeyEvent *e);
 
+    // What a key combination does, see keyActions()
+    enum KeyAction : uint {
+        CopyAction = 1 << 0,
+        PasteAction = 1 << 1,
+        PasteSelectionAction = 1 << 2,
+        CutAction = 1 << 3,
+        UndoAction = 1 << 4,
+        RedoAction = 1 << 5,
+        DeleteWordBackAction = 1 << 6,
+        DeleteWordForwardAction = 1 << 7,
+        BackwardWordAction = 1 << 8,
+        ForwardWordAction = 1 << 9,
+        BeginningOfLineAction = 1 << 10,
+        EndOfLineAction = 1 << 11,
+        TextCompletionAction = 1 << 12,
+        PrevCompletionMatchAction = 1 << 13,
+        NextCompletionMatchAction = 1 << 14,
+        SubstringCompletionAction = 1 << 15,
+    };
+
+    // Returns the KeyAction flags of the standard shortcuts and key bindings containing key
+    uint keyActions(int key);
+    void updateKeyActions(const KLineEdit::KeyBindingMap &keyBindings);
+
     void init();
 
     bool copySqueezedText(bool copy) const;
@@ -51,18 +85,37 @@ public:
 
     QMap<KCompletion::CompletionMode, bool> disableCompletionMap;
 
+    // the actions of every key, built from the shortcuts once they change
+    QHash<int, uint> keyActionTable;
+    // the key bindings keyActionTable was built for
+    KLineEdit::KeyBindingMap keyActionBindings;
+
     QColor previousHighlightColor;
     QColor previousHighlightedTextColor;
 
     QPalette::ColorRole bgRole;
 
     QString squeezedText;
+    // what setSqueezedText() measured last time
+    struct {
+        QString text;
+        QFont font;
+        int textWidth = 0;
+        int labelWidth = -1; // the width letters was computed for
+        int letters = 0;
+    } squeezeCache;
     QString userText;
     QString lastStyleClass;
 
     QMetaObject::Connection m_matchesConnection;
+    QMetaObject::Connection m_moreMatchesConnection;
+    QMetaObject::Connection m_completionReadyConnection;
     KCompletionBox *completionBox;
 
+    // started by every completion done by requestCompletion()
+    QTimer *completionTimer = nullptr;
+    QString pendingCompletionText;
+
     KLineEditUrlDropEventFilter *urlDropEventFilter;
 
     QAction *noCompletionAction;
@@ -77,6 +130,7 @@ public:
 
     int squeezedEnd;
     int squeezedStart;
+    int completionDelay = 0;
 
     static bool s_initialized;
     static bool s_backspacePerformsCompletion; // Configuration option
@@ -91,6 +145,11 @@ public:
     bool italicizePlaceholder : 1;
     bool threeStars : 1;
     bool possibleTripleClick : 1; // set in mousePressEvent, deleted in tripleClickTimeout
+    bool streamingMatches : 1; // the completion box gets the matches of KCompletion::streamMatches()
+    bool completionPending : 1; // pendingCompletionText is to be completed once completionTimer is over
+    bool pendingAutoSuggest : 1; // the autoSuggest value when pendingCompletionText was requested
+    bool requestAutoSuggest : 1; // the same for the pending KCompletion::requestCompletion()
+    bool keyActionsDirty : 1; // a standard shortcut changed since keyActionTable was built
     Q_DECLARE_PUBLIC(KLineEdit)
 };
 
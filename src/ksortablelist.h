@@ -13,6 +13,11 @@
 #include <QList>
 #include <QPair>
 #include <algorithm>
+#include <climits>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 /*!
  * \class KSortableItem
@@ -48,6 +53,15 @@ public:
     {
     }
 
+    /*!
+     * Creates a new KSortableItem, moving the values of another one.
+     *
+     * \a rhs the other item to move from
+     *
+     * \since 6.30
+     */
+    KSortableItem(KSortableItem<T, Key> &&rhs) = default;
+
     /*!
      * Creates a new KSortableItem with uninitialized values.
      */
@@ -65,6 +79,13 @@ public:
         return *this;
     }
 
+    /*!
+     * Move assignment operator.
+     *
+     * \since 6.30
+     */
+    KSortableItem<T, Key> &operator=(KSortableItem<T, Key> &&i) = default;
+
     // operators for sorting
     /*!
      * Compares the two items. This implementation only compares
@@ -186,10 +207,196 @@ public:
 
     /*!
      * Sorts the KSortableItems.
+     *
+     * Items with equal keys keep their relative order.
+     *
+     * Only the keys are sorted, together with the position of their item,
+     * the items are then moved into place once. Integral keys are sorted
+     * with a radix sort.
      */
     void sort()
     {
-        std::sort(this->begin(), this->end());
+        const qsizetype count = this->size();
+        if (count < 2) {
+            return;
+        }
+
+        std::vector<KeyIndex> keys;
+        keys.reserve(count);
+        for (qsizetype i = 0; i < count; ++i) {
+            keys.emplace_back(QList<KSortableItem<T, Key>>::at(i).first, i);
+        }
+
+        if constexpr (std::is_integral_v<Key> && !std::is_same_v<Key, bool>) {
+            if (count >= RadixSortThreshold) {
+                radixSort(keys);
+            } else {
+                sortKeys(keys);
+            }
+        } else {
+            sortKeys(keys);
+        }
+
+        bool sorted = true;
+        for (qsizetype i = 0; i < count; ++i) {
+            if (keys[i].second != i) {
+                sorted = false;
+                break;
+            }
+        }
+        if (sorted) {
+            return;
+        }
+
+        KSortableItem<T, Key> *items = this->data();
+        QList<KSortableItem<T, Key>> result;
+        result.reserve(count);
+        for (const KeyIndex &key : keys) {
+            result.append(std::move(items[key.second]));
+        }
+        QList<KSortableItem<T, Key>>::operator=(std::move(result));
+    }
+
+    /*!
+     * Sorts the first \a count KSortableItems in \a order, leaving the
+     * remaining ones in unspecified order.
+     *
+     * This is cheaper than sort() when only the first items are needed.
+     * The relative order of items with equal keys is unspecified.
+     *
+     * \since 6.30
+     */
+    void partialSort(qsizetype count, Qt::SortOrder order = Qt::AscendingOrder)
+    {
+        count = std::clamp(count, qsizetype(0), this->size());
+        if (order == Qt::AscendingOrder) {
+            std::partial_sort(this->begin(), this->begin() + count, this->end());
+        } else {
+            std::partial_sort(this->begin(), this->begin() + count, this->end(), std::greater<KSortableItem<T, Key>>());
+        }
+    }
+
+    /*!
+     * Rearranges the KSortableItems so that the item at position \a n is the
+     * one that would be there if the list was sorted in \a order, all items
+     * before it not being sorted after it and all items after it not being
+     * sorted before it.
+     *
+     * \since 6.30
+     */
+    void nthElement(qsizetype n, Qt::SortOrder order = Qt::AscendingOrder)
+    {
+        if (n < 0 || n >= this->size()) {
+            return;
+        }
+        if (order == Qt::AscendingOrder) {
+            std::nth_element(this->begin(), this->begin() + n, this->end());
+        } else {
+            std::nth_element(this->begin(), this->begin() + n, this->end(), std::greater<KSortableItem<T, Key>>());
+        }
+    }
+
+    /*!
+     * Returns the \a count KSortableItems with the largest keys, the largest
+     * first, without modifying this list.
+     *
+     * Among items with equal keys, the one inserted last comes first, so the
+     * result is the beginning of this list sorted with sort() and reversed.
+     *
+     * \since 6.30
+     */
+    KSortableList<T, Key> largest(qsizetype count) const
+    {
+        count = std::clamp(count, qsizetype(0), this->size());
+
+        // "a ranks before b" in the reversed stable order
+        const auto before = [this](qsizetype a, qsizetype b) {
+            const KSortableItem<T, Key> &itemA = QList<KSortableItem<T, Key>>::at(a);
+            const KSortableItem<T, Key> &itemB = QList<KSortableItem<T, Key>>::at(b);
+            if (itemB < itemA) {
+                return true;
+            }
+            if (itemA < itemB) {
+                return false;
+            }
+            return a > b;
+        };
+
+        // heap of the best indexes seen so far, the worst of them on top
+        std::vector<qsizetype> heap;
+        heap.reserve(count);
+        for (qsizetype i = 0; i < this->size() && count > 0; ++i) {
+            if (qsizetype(heap.size()) < count) {
+                heap.push_back(i);
+                std::push_heap(heap.begin(), heap.end(), before);
+            } else if (before(i, heap.front())) {
+                std::pop_heap(heap.begin(), heap.end(), before);
+                heap.back() = i;
+                std::push_heap(heap.begin(), heap.end(), before);
+            }
+        }
+        std::sort_heap(heap.begin(), heap.end(), before);
+
+        KSortableList<T, Key> result;
+        result.reserve(count);
+        for (const qsizetype i : heap) {
+            result.append(QList<KSortableItem<T, Key>>::at(i));
+        }
+        return result;
+    }
+
+private:
+    typedef std::pair<Key, qsizetype> KeyIndex;
+
+    // below that, std::sort beats the fixed cost of the radix passes
+    static constexpr qsizetype RadixSortThreshold = 256;
+
+    // sorts by key, then by position, which makes the sort stable
+    static void sortKeys(std::vector<KeyIndex> &keys)
+    {
+        std::sort(keys.begin(), keys.end(), [](const KeyIndex &a, const KeyIndex &b) {
+            if (a.first < b.first) {
+                return true;
+            }
+            if (b.first < a.first) {
+                return false;
+            }
+            return a.second < b.second;
+        });
+    }
+
+    // LSD radix sort on the bytes of the keys, stable as long as keys is
+    // initially ordered by position
+    static void radixSort(std::vector<KeyIndex> &keys)
+    {
+        using UKey = std::make_unsigned_t<Key>;
+        constexpr int bits = sizeof(Key) * CHAR_BIT;
+        // flip the sign bit so that negative keys come first
+        constexpr UKey signFlip = std::is_signed_v<Key> ? UKey(UKey(1) << (bits - 1)) : UKey(0);
+
+        std::vector<KeyIndex> buffer(keys.size());
+        for (int shift = 0; shift < bits; shift += 8) {
+            qsizetype offsets[256] = {};
+            for (const KeyIndex &key : keys) {
+                ++offsets[((UKey(key.first) ^ signFlip) >> shift) & 0xff];
+            }
+
+            // all keys share this byte, the pass would not change anything
+            if (std::find(std::begin(offsets), std::end(offsets), qsizetype(keys.size())) != std::end(offsets)) {
+                continue;
+            }
+
+            qsizetype total = 0;
+            for (qsizetype &offset : offsets) {
+                const qsizetype bucketSize = offset;
+                offset = total;
+                total += bucketSize;
+            }
+            for (const KeyIndex &key : keys) {
+                buffer[offsets[((UKey(key.first) ^ signFlip) >> shift) & 0xff]++] = key;
+            }
+            keys.swap(buffer);
+        }
     }
 };
 
@@ -313,3 +313,36 @@ void KZoneAllocator::free_since(void *ptr)
     }
     d->blockOffset = ((char *)ptr) - d->currentBlock->begin;
 }
+
+void KZoneAllocator::takeBlocks(KZoneAllocator &other)
+{
+    Q_ASSERT(other.d->blockSize == d->blockSize);
+    MemBlock *newest = other.d->currentBlock;
+    if (!newest) {
+        return;
+    }
+    MemBlock *oldest = newest;
+    while (oldest->older) {
+        oldest = oldest->older;
+    }
+
+    if (d->currentBlock) {
+        /* Put the blocks of other right behind the current block.  */
+        oldest->older = d->currentBlock->older;
+        if (oldest->older) {
+            oldest->older->newer = oldest;
+        }
+        newest->newer = d->currentBlock;
+        d->currentBlock->older = newest;
+    } else {
+        d->currentBlock = newest;
+        d->blockOffset = other.d->blockOffset;
+    }
+    d->num_blocks += other.d->num_blocks;
+    d->hashDirty = true;
+
+    other.d->currentBlock = nullptr;
+    other.d->num_blocks = 0;
+    other.d->blockOffset = other.d->blockSize + 1;
+    other.d->hashDirty = true;
+}
@@ -98,6 +98,14 @@ public:
      */
     void free_since(void *ptr);
 
+    /*!
+     * Takes over all memory blocks of \a other, which must have been created
+     * with the same block size. The objects allocated by \a other can be
+     * deallocated by this allocator then, \a other is empty afterwards.
+     * Allocation continues in the current block of this allocator.
+     */
+    void takeBlocks(KZoneAllocator &other);
+
 protected:
     /*! A single chunk of memory from the heap. \internal */
     class MemBlock;